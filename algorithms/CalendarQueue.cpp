@@ -0,0 +1,148 @@
+#include "CalendarQueue.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+SimulationEventPool::SimulationEventPool() :
+	freeList(nullptr) {}
+
+
+SimulationEvent* SimulationEventPool::allocate() {
+	if (freeList == nullptr) {
+		chunks.emplace_back(new SimulationEvent[chunkSize]);
+		SimulationEvent* chunk = chunks.back().get();
+		for (size_t i = 0; i < chunkSize; i++) {
+			chunk[i].next = freeList;
+			freeList = &chunk[i];
+		}
+	}
+
+	SimulationEvent* event = freeList;
+	freeList = event->next;
+	return event;
+}
+
+
+void SimulationEventPool::release(SimulationEvent* event) {
+	event->next = freeList;
+	freeList = event;
+}
+
+
+CalendarQueue::CalendarQueue() :
+	buckets(minimumBucketCount, nullptr),
+	bucketMask(minimumBucketCount - 1),
+	width(1),
+	currentSlot(0),
+	lastTime(0),
+	count(0) {}
+
+
+uint64_t CalendarQueue::slotOf(double time) const {
+	return static_cast<uint64_t>(time / width);
+}
+
+
+void CalendarQueue::insert(SimulationEvent* event) {
+	// Insert after every event with an equal or earlier time, keeping the bucket sorted and ties first in, first out.
+	SimulationEvent** link = &buckets[slotOf(event->time) & bucketMask];
+	while (*link != nullptr && (*link)->time <= event->time) {
+		link = &(*link)->next;
+	}
+	event->next = *link;
+	*link = event;
+}
+
+
+void CalendarQueue::push(SimulationEvent* event) {
+	insert(event);
+	count++;
+
+	if (count > 2 * buckets.size()) {
+		resize(2 * buckets.size());
+	}
+}
+
+
+SimulationEvent* CalendarQueue::pop() {
+	if (count == 0) {
+		return nullptr;
+	}
+
+	// Scan one year of buckets from the current slot for an event due in its slot.
+	SimulationEvent* event = nullptr;
+	for (size_t scanned = 0; scanned <= bucketMask; scanned++, currentSlot++) {
+		SimulationEvent* head = buckets[currentSlot & bucketMask];
+		if (head != nullptr && slotOf(head->time) <= currentSlot) {
+			event = head;
+			break;
+		}
+	}
+
+	// Every pending event is more than a year ahead, so jump straight to the earliest one.
+	if (event == nullptr) {
+		for (SimulationEvent* head : buckets) {
+			if (head != nullptr && (event == nullptr || head->time < event->time)) {
+				event = head;
+			}
+		}
+		currentSlot = slotOf(event->time);
+	}
+
+	buckets[currentSlot & bucketMask] = event->next;
+	lastTime = event->time;
+	count--;
+
+	if (count < buckets.size() / 2 && buckets.size() > minimumBucketCount) {
+		resize(buckets.size() / 2);
+	}
+
+	return event;
+}
+
+
+size_t CalendarQueue::size() const {
+	return count;
+}
+
+
+bool CalendarQueue::empty() const {
+	return count == 0;
+}
+
+
+void CalendarQueue::resize(size_t bucketCount) {
+	// Collect every event, set the width to three times the mean spacing of the earliest events as Brown suggests,
+	// and reinsert the events. Each old bucket is walked in order, so events with equal times keep their order.
+	vector<SimulationEvent*> events;
+	events.reserve(count);
+	for (SimulationEvent* head : buckets) {
+		for (SimulationEvent* event = head; event != nullptr; event = event->next) {
+			events.push_back(event);
+		}
+	}
+
+	const size_t sampleSize = min<size_t>(events.size(), 25);
+	if (sampleSize >= 2) {
+		vector<double> times(events.size());
+		for (size_t i = 0; i < events.size(); i++) {
+			times[i] = events[i]->time;
+		}
+		nth_element(times.begin(), times.begin() + (sampleSize - 1), times.end());
+		double earliest = *min_element(times.begin(), times.begin() + (sampleSize - 1));
+		double spacing = (times[sampleSize - 1] - earliest) / (sampleSize - 1);
+		if (spacing > 0) {
+			width = 3 * spacing;
+		}
+	}
+
+	buckets.assign(bucketCount, nullptr);
+	bucketMask = bucketCount - 1;
+	currentSlot = slotOf(lastTime);
+	for (SimulationEvent* event : events) {
+		insert(event);
+	}
+}
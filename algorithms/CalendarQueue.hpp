@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Event of a discrete-event simulation. next links events within a calendar bucket and in the pool's free list.
+struct SimulationEvent {
+	enum class Type : uint32_t { arrival, departure };
+
+	double time;
+	double customerArrivalTime;
+	SimulationEvent* next;
+	Type type;
+	bool lastOfChunk;
+};
+
+// Allocator of SimulationEvents in chunks, reusing released events through a free list, so scheduling an event
+// does not go to the heap once the pool has grown to the peak number of live events. Events are freed with the pool.
+class SimulationEventPool {
+public:
+	SimulationEventPool();
+	SimulationEventPool(const SimulationEventPool&) = delete;
+	SimulationEventPool& operator=(const SimulationEventPool&) = delete;
+
+	SimulationEvent* allocate();
+	void release(SimulationEvent* event);
+
+private:
+	static const size_t chunkSize = 4096;
+
+	std::vector<std::unique_ptr<SimulationEvent[]>> chunks;
+	SimulationEvent* freeList;
+};
+
+// Brown's calendar queue: a ring of buckets, each a sorted list of the events whose times fall in one bucket-width
+// slot, with the same bucket reused every ring length of slots. The bucket count doubles or halves as the number of
+// events grows or shrinks, and the width is reset from the spacing of the earliest events, so push and pop take
+// O(1) amortized time for any number of pending events. Events must not be pushed earlier than the last one popped.
+// Events with equal times pop in the order they were pushed.
+class CalendarQueue {
+public:
+	CalendarQueue();
+
+	void push(SimulationEvent* event);
+	// Remove and return the earliest event, or nullptr when empty.
+	SimulationEvent* pop();
+	size_t size() const;
+	bool empty() const;
+
+private:
+	uint64_t slotOf(double time) const;
+	void insert(SimulationEvent* event);
+	void resize(size_t bucketCount);
+
+	static const size_t minimumBucketCount = 16;
+
+	std::vector<SimulationEvent*> buckets;
+	size_t bucketMask;
+	double width;
+	uint64_t currentSlot;
+	double lastTime;
+	size_t count;
+};
@@ -2,7 +2,17 @@
 #include "Logging.hpp"
 #include "Usage.hpp"
 #include "PoissonProcess.hpp"
+#include "PoissonCache.hpp"
+#include "PoissonSuperposition.hpp"
+#include "NonHomogeneousPoissonProcess.hpp"
+#include "QueueSimulation.hpp"
+#include "SampleWriter.hpp"
 #include "Matrix.hpp"
+#include "MatrixBinary.hpp"
+#include "MatrixMultiply.hpp"
+#include "MatrixMarket.hpp"
+#include "MatrixFactorization.hpp"
+#include "OutOfCoreMatrix.hpp"
 #include "PrettyPrint.hpp"
 #include "Agent.hpp"
 
@@ -10,7 +20,13 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <random>
 #include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <limits>
+#include <type_traits>
 
 
 using namespace std;
@@ -26,6 +42,101 @@ string Command::name() const {
 }
 
 
+bool Command::parseOptions(
+	int argc, char** argv, int firstOption,
+	const vector<string>& allowedOptions,
+	unordered_map<string, string>& options) {
+	// Parse trailing "--name value" pairs from argv[firstOption..] into options. Prints an error and returns
+	// false for an unknown option or one missing its value.
+
+	for (int i = firstOption; i < argc; i += 2) {
+		string arg(argv[i]);
+		if (arg.compare(0, 2, "--") != 0) {
+			cout << "ERROR: Expected an option but found " << arg << "." << endl;
+			return false;
+		}
+
+		string optionName = arg.substr(2);
+		if (find(allowedOptions.begin(), allowedOptions.end(), optionName) == allowedOptions.end()) {
+			cout << "ERROR: Unknown option " << arg << "." << endl;
+			return false;
+		}
+		if (i + 1 >= argc) {
+			cout << "ERROR: Option " << arg << " requires a value." << endl;
+			return false;
+		}
+
+		options[optionName] = argv[i + 1];
+	}
+
+	return true;
+}
+
+
+static bool parseEngineOption(unordered_map<string, string>& options, RandomEngineType& engineType) {
+	if (options.count("engine") && !parseRandomEngineType(options["engine"], engineType)) {
+		cout << "ERROR: Unknown engine " << options["engine"] << "." << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+template<class valueType>
+static bool parseNumericOption(unordered_map<string, string>& options, const string& name, valueType& value) {
+	// Parse the whole of --name into value, leaving value unchanged if the option is absent. Prints an error and
+	// returns false for a value that is not a number of the option's type, including a negative one for an unsigned
+	// option, which the stream would otherwise wrap around.
+
+	if (!options.count(name)) {
+		return true;
+	}
+
+	const string& text = options[name];
+	valueType parsed;
+	stringstream stream(text);
+	if ((is_unsigned<valueType>::value && text.find('-') != string::npos) || !(stream >> parsed) || !stream.eof()) {
+		cout << "ERROR: Invalid --" << name << " " << text << "." << endl;
+		return false;
+	}
+
+	value = parsed;
+	return true;
+}
+
+
+static void printPoissonProbability(
+	PoissonQuantity quantity, double rate, double duration, unsigned long number,
+	unordered_map<string, string>& options) {
+	// Print the PMF or CDF, through a PoissonEvaluationCache backed by the file given with --cache if any.
+
+	if (!options.count("cache")) {
+		cout << (quantity == PoissonQuantity::pmf ?
+			evalPoissonProcessIntervalPMF(rate, duration, number) :
+			evalPoissonProcessIntervalCDF(rate, duration, number)) << endl;
+		return;
+	}
+
+	try {
+		PoissonEvaluationCache cache(4096, options["cache"]);
+		cout << (quantity == PoissonQuantity::pmf ?
+			cache.pmf(rate, duration, number) :
+			cache.cdf(rate, duration, number)) << endl;
+
+		if (options["cache-stats"] == "yes") {
+			const PoissonCacheStatistics& statistics = cache.statistics();
+			cout << "Cache memory hits: " << statistics.memoryHits
+				<< ", disk hits: " << statistics.diskHits
+				<< ", misses: " << statistics.misses << endl;
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
 PoissonProcessPMFSubCommand::PoissonProcessPMFSubCommand() {
 	m_name = "pmf";
 }
@@ -36,20 +147,25 @@ void PoissonProcessPMFSubCommand::run(int argc, char** argv) {
 		cout << "DEBUG: Running PoissonProcessPMFSubCommand" << endl;
 	);
 
-	if (argc != 6) {
+	if (argc < 6) {
 		cout << "ERROR: Wrong number of arguments." << endl;
 		printUsage(argc, argv);
 		return;
 	}
 
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 6, { "cache", "cache-stats" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
 	stringstream argStream;
 	double rate, duration;
 	unsigned long number;
 	argStream << argv[3] << " " << argv[4] << " " << argv[5];
 	argStream >> rate >> duration >> number;
 
-	double poissonProbability = evalPoissonProcessIntervalPMF(rate, duration, number);
-	cout << poissonProbability << endl;
+	printPoissonProbability(PoissonQuantity::pmf, rate, duration, number, options);
 }
 
 PoissonProcessCDFSubCommand::PoissonProcessCDFSubCommand() {
@@ -61,6 +177,73 @@ void PoissonProcessCDFSubCommand::run(int argc, char** argv) {
 		cout << "DEBUG: Running PoissonProcessCDFSubCommand" << endl;
 	);
 
+	if (argc < 6) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 6, { "cache", "cache-stats" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	stringstream argStream;
+	double rate, duration;
+	unsigned long number;
+	argStream << argv[3] << " " << argv[4] << " " << argv[5];
+	argStream >> rate >> duration >> number;
+
+	printPoissonProbability(PoissonQuantity::cdf, rate, duration, number, options);
+}
+
+
+PoissonProcessQuantileSubCommand::PoissonProcessQuantileSubCommand() {
+	m_name = "quantile";
+}
+
+void PoissonProcessQuantileSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running PoissonProcessQuantileSubCommand" << endl;
+	);
+
+	if (argc < 6) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	stringstream argStream;
+	double rate, duration;
+	vector<double> probabilities(argc - 5);
+	argStream << argv[3] << " " << argv[4];
+	argStream >> rate >> duration;
+	for (int i = 5; i < argc; i++) {
+		stringstream probabilityStream(argv[i]);
+		if (!(probabilityStream >> probabilities[i - 5])) {
+			cout << "ERROR: Cannot parse probability " << argv[i] << "." << endl;
+			return;
+		}
+	}
+
+	vector<unsigned long> quantiles = evalPoissonProcessIntervalQuantiles(rate, duration, probabilities);
+	for (unsigned long quantile : quantiles) {
+		cout << quantile << '\n';
+	}
+	cout.flush();
+}
+
+
+PoissonProcessPMFTableSubCommand::PoissonProcessPMFTableSubCommand() {
+	m_name = "pmf-table";
+}
+
+void PoissonProcessPMFTableSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running PoissonProcessPMFTableSubCommand" << endl;
+	);
+
 	if (argc != 6) {
 		cout << "ERROR: Wrong number of arguments." << endl;
 		printUsage(argc, argv);
@@ -73,11 +256,11 @@ void PoissonProcessCDFSubCommand::run(int argc, char** argv) {
 	argStream << argv[3] << " " << argv[4] << " " << argv[5];
 	argStream >> rate >> duration >> number;
 
-	double poissonProbability = 0;
+	PoissonDistributionTable table = evalPoissonProcessIntervalTable(rate, duration, number);
+
 	for (unsigned long i = 0; i <= number; i++) {
-		poissonProbability += evalPoissonProcessIntervalPMF(rate, duration, i);
+		cout << i << ' ' << table.pmf[i] << ' ' << table.cdf[i] << '\n';
 	}
-	cout << poissonProbability << endl;
 }
 
 
@@ -91,25 +274,123 @@ void PoissonProcessSampleArrivalTimesSubCommand::run(int argc, char** argv) {
 		cout << "DEBUG: Running PoissonProcessSampleArrivalTimesSubCommand" << endl;
 	);
 
-	if (argc != 6) {
+	if (argc < 6) {
 		cout << "ERROR: Wrong number of arguments." << endl;
 		printUsage(argc, argv);
 		return;
 	}
 
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 6, { "threads", "format", "output", "engine" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
 	stringstream argStream;
 	double rate;
-	unsigned long number, seed;
+	unsigned long long number;
+	unsigned long seed;
+	unsigned int threads = 1;
+	SampleFormat format = SampleFormat::text;
+	RandomEngineType engineType = RandomEngineType::mt19937;
 	argStream << argv[3] << " " << argv[4] << " " << argv[5];
 	argStream >> rate >> number >> seed;
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (options.count("format") && !parseSampleFormat(options["format"], format)) {
+		cout << "ERROR: Unknown format " << options["format"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseEngineOption(options, engineType)) {
+		printUsage(argc, argv);
+		return;
+	}
 	LOG_DEBUG(
-		cout << "DEBUG: argStream " << argStream.str() << endl;
+		cout << "DEBUG: argStream " << argStream.str() << " threads " << threads << endl;
+	);
+
+	// Stream the arrival times a chunk at a time, so memory use does not grow with number and output starts
+	// after the first chunk.
+	if (seed == 0) {
+		seed = random_device()();
+	}
+	try {
+		SampleWriter writer(format, options["output"], "arrival_time", number);
+		PoissonArrivalStream arrivalStream(PoissonSampler(seed, engineType), rate, number, threads);
+		while (arrivalStream.remaining() > 0) {
+			const vector<double>& arrivalTimes = arrivalStream.next();
+			writer.write(arrivalTimes.data(), arrivalTimes.size());
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+PoissonProcessSampleInterArrivalTimesSubCommand::PoissonProcessSampleInterArrivalTimesSubCommand() {
+	m_name = "sample-inter-arrival-times";
+}
+
+
+void PoissonProcessSampleInterArrivalTimesSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running PoissonProcessSampleInterArrivalTimesSubCommand" << endl;
 	);
 
-	vector<double> arrivalTimes = samplePoissonProcessArrivalTimes(rate, number, seed);
+	if (argc < 6) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 6, { "first", "format", "output", "engine" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	stringstream argStream;
+	double rate;
+	unsigned long long number, first = 0;
+	unsigned long seed;
+	SampleFormat format = SampleFormat::text;
+	RandomEngineType engineType = RandomEngineType::mt19937;
+	argStream << argv[3] << " " << argv[4] << " " << argv[5];
+	argStream >> rate >> number >> seed;
+	if (!parseNumericOption(options, "first", first)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (options.count("format") && !parseSampleFormat(options["format"], format)) {
+		cout << "ERROR: Unknown format " << options["format"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseEngineOption(options, engineType)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (seed == 0) {
+		cout << "ERROR: A nonzero seed is required to address a slice of a sequence." << endl;
+		return;
+	}
 
-	for (unsigned long i = 0; i < number; i++) {
-		cout << arrivalTimes[i] << '\n';
+	try {
+		SampleWriter writer(format, options["output"], "inter_arrival_time", number);
+		PoissonSampler sampler(seed, engineType);
+		vector<double> interArrivalTimes(arrivalTimesBlockSize);
+		for (unsigned long long written = 0; written < number; written += interArrivalTimes.size()) {
+			size_t count = static_cast<size_t>(min<unsigned long long>(interArrivalTimes.size(), number - written));
+			fillPoissonProcessInterArrivalTimes(sampler, rate, interArrivalTimes.data(), count, first + written);
+			writer.write(interArrivalTimes.data(), count);
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
 	}
 }
 
@@ -124,55 +405,936 @@ void PoissonProcessSampleNumberArrivalsSubCommand::run(int argc, char** argv) {
 		cout << "DEBUG: Running PoissonProcessSampleNumberArrivalsSubCommand" << endl;
 	);
 
-	if (argc != 6) {
+	if (argc < 6) {
 		cout << "ERROR: Wrong number of arguments." << endl;
 		printUsage(argc, argv);
 		return;
 	}
 
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 6, { "count", "threads", "engine" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
 	stringstream argStream;
 	double rate, duration;
 	unsigned long seed;
+	RandomEngineType engineType = RandomEngineType::mt19937;
 	argStream << argv[3] << " " << argv[4] << " " << argv[5];
 	argStream >> rate >> duration >> seed;
+	if (!parseEngineOption(options, engineType)) {
+		printUsage(argc, argv);
+		return;
+	}
 	LOG_DEBUG(
 		cout << "DEBUG: argStream " << argStream.str() << endl;
 	);
 
-	unsigned long numberArrivals = samplePoissonProcessNumberArrivals(rate, duration, seed);
+	if (!options.count("count")) {
+		unsigned long numberArrivals = samplePoissonProcessNumberArrivals(rate, duration, seed, engineType);
+
+		cout << numberArrivals << endl;
+		return;
+	}
+
+	unsigned long long count = 0;
+	unsigned int threads = 1;
+	if (!parseNumericOption(options, "count", count) || !parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	PoissonSampleSummary summary = samplePoissonProcessNumberArrivalsSummary(rate, duration, count, seed, threads, engineType);
 
-	cout << numberArrivals << endl;
+	cout << "count " << summary.count << '\n'
+		<< "mean " << summary.mean << '\n'
+		<< "variance " << summary.variance << '\n'
+		<< "skewness " << summary.skewness << '\n'
+		<< "excess-kurtosis " << summary.excessKurtosis << '\n'
+		<< "chi-square " << summary.chiSquare << '\n'
+		<< "degrees-of-freedom " << summary.degreesOfFreedom << '\n'
+		<< "p-value " << summary.pValue << '\n'
+		<< "histogram\n";
+	for (size_t i = 0; i < summary.counts.size(); i++) {
+		if (summary.counts[i] > 0) {
+			cout << summary.minimum + i << ' ' << summary.counts[i] << '\n';
+		}
+	}
+	cout.flush();
 }
 
 
-MatrixTestSubCommand::MatrixTestSubCommand() {
-	m_name = "test";
+PoissonProcessSuperposeSubCommand::PoissonProcessSuperposeSubCommand() {
+	m_name = "superpose";
 }
 
-void MatrixTestSubCommand::run(int argc, char** argv) {
+
+void PoissonProcessSuperposeSubCommand::run(int argc, char** argv) {
 	LOG_DEBUG(
-		cout << "DEBUG: Running MatrixTestSubCommand" << endl;
+		cout << "DEBUG: Running PoissonProcessSuperposeSubCommand" << endl;
 	);
 
-	if (argc != 4) {
+	if (argc < 6) {
 		cout << "ERROR: Wrong number of arguments." << endl;
 		printUsage(argc, argv);
 		return;
 	}
 
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 6, { "format", "output", "engine" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
 	stringstream argStream;
-	string matrixFilename;
-	argStream << argv[3];
-	argStream >> matrixFilename;
+	string ratesFilename;
+	unsigned long long number;
+	unsigned long seed;
+	SampleFormat format = SampleFormat::text;
+	RandomEngineType engineType = RandomEngineType::mt19937;
+	argStream << argv[3] << " " << argv[4] << " " << argv[5];
+	argStream >> ratesFilename >> number >> seed;
+	if (options.count("format") && !parseSampleFormat(options["format"], format)) {
+		cout << "ERROR: Unknown format " << options["format"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseEngineOption(options, engineType)) {
+		printUsage(argc, argv);
+		return;
+	}
 	LOG_DEBUG(
 		cout << "DEBUG: argStream " << argStream.str() << endl;
 	);
 
-	Matrix<double> matrix = Matrix<double>::load(matrixFilename);
+	if (seed == 0) {
+		seed = random_device()();
+	}
+	try {
+		PoissonSuperposition superposition(loadArrivalRates(ratesFilename), PoissonSampler(seed, engineType));
+		if (superposition.empty() && number > 0) {
+			cout << "ERROR: No source in " << ratesFilename << " has a positive arrival rate." << endl;
+			return;
+		}
+
+		SampleWriter writer(format, options["output"], "arrival_time", number, "source");
+		const size_t chunkSize = 1 << 16;
+		vector<double> arrivalTimes(chunkSize);
+		vector<unsigned long long> sources(chunkSize);
+		for (unsigned long long written = 0; written < number; written += chunkSize) {
+			size_t count = static_cast<size_t>(min<unsigned long long>(chunkSize, number - written));
+			superposition.fill(arrivalTimes.data(), sources.data(), count);
+			writer.write(arrivalTimes.data(), sources.data(), count);
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+PoissonProcessSampleProfileArrivalTimesSubCommand::PoissonProcessSampleProfileArrivalTimesSubCommand() {
+	m_name = "sample-profile-arrival-times";
+}
+
+void PoissonProcessSampleProfileArrivalTimesSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running PoissonProcessSampleProfileArrivalTimesSubCommand" << endl;
+	);
+
+	if (argc < 6) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 6, { "interpolation", "threads", "format", "output", "engine" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	stringstream argStream;
+	string profileFilename;
+	unsigned long long number;
+	unsigned long seed;
+	RateInterpolation interpolation = RateInterpolation::constant;
+	unsigned int threads = 1;
+	SampleFormat format = SampleFormat::text;
+	RandomEngineType engineType = RandomEngineType::mt19937;
+	argStream << argv[3] << " " << argv[4] << " " << argv[5];
+	argStream >> profileFilename >> number >> seed;
+	if (options.count("interpolation") && !parseRateInterpolation(options["interpolation"], interpolation)) {
+		cout << "ERROR: Unknown interpolation " << options["interpolation"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (options.count("format") && !parseSampleFormat(options["format"], format)) {
+		cout << "ERROR: Unknown format " << options["format"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseEngineOption(options, engineType)) {
+		printUsage(argc, argv);
+		return;
+	}
+	LOG_DEBUG(
+		cout << "DEBUG: argStream " << argStream.str() << " threads " << threads << endl;
+	);
+
+	if (seed == 0) {
+		seed = random_device()();
+	}
+	try {
+		RateProfile profile = loadRateProfile(profileFilename, interpolation);
+		SampleWriter writer(format, options["output"], "arrival_time", number);
+		RateProfileArrivalStream arrivalStream(PoissonSampler(seed, engineType), profile, number, threads);
+		while (arrivalStream.remaining() > 0) {
+			const vector<double>& arrivalTimes = arrivalStream.next();
+			writer.write(arrivalTimes.data(), arrivalTimes.size());
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
 
-	cout << matrix;
+
+PoissonProcessSimulateQueueSubCommand::PoissonProcessSimulateQueueSubCommand() {
+	m_name = "simulate-queue";
 }
 
+void PoissonProcessSimulateQueueSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running PoissonProcessSimulateQueueSubCommand" << endl;
+	);
+
+	if (argc < 8) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 8, { "service", "service-cv", "report", "threads", "engine" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	stringstream argStream;
+	double arrivalRate, serviceRate;
+	unsigned int servers;
+	unsigned long long customers;
+	unsigned long seed;
+	ServiceDistribution distribution = ServiceDistribution::exponential;
+	double serviceCV = 1;
+	unsigned long long reportInterval;
+	unsigned int threads = 1;
+	RandomEngineType engineType = RandomEngineType::mt19937;
+	argStream << argv[3] << " " << argv[4] << " " << argv[5] << " " << argv[6] << " " << argv[7];
+	argStream >> arrivalRate >> serviceRate >> servers >> customers >> seed;
+	if (!argStream || arrivalRate <= 0 || serviceRate <= 0 || servers == 0) {
+		cout << "ERROR: Rates and servers must be positive." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (options.count("service") && !parseServiceDistribution(options["service"], distribution)) {
+		cout << "ERROR: Unknown service distribution " << options["service"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "service-cv", serviceCV)) {
+		printUsage(argc, argv);
+		return;
+	}
+	reportInterval = max(1ull, customers / 10);
+	if (!parseNumericOption(options, "report", reportInterval)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (reportInterval == 0) {
+		cout << "ERROR: --report must be at least 1." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseEngineOption(options, engineType)) {
+		printUsage(argc, argv);
+		return;
+	}
+	LOG_DEBUG(
+		cout << "DEBUG: argStream " << argStream.str() << " report " << reportInterval << endl;
+	);
+
+	// Print a line of running statistics every reportInterval departures, the last line covering every customer.
+	if (seed == 0) {
+		seed = random_device()();
+	}
+	QueueSimulation simulation(
+		PoissonSampler(seed, engineType), arrivalRate, serviceRate, servers, customers, distribution, serviceCV, threads);
+	cout << "customers time utilization mean_queue_length mean_wait mean_latency sd_latency"
+		" p50_latency p90_latency p99_latency p999_latency max_latency" << endl;
+	bool remaining = customers > 0;
+	while (remaining) {
+		remaining = simulation.run(reportInterval);
+
+		const QueueStatistics& statistics = simulation.statistics();
+		cout << statistics.customers
+			<< " " << statistics.elapsedTime
+			<< " " << statistics.utilization(simulation.servers())
+			<< " " << statistics.meanQueueLength()
+			<< " " << statistics.meanWait
+			<< " " << statistics.meanLatency
+			<< " " << statistics.latencyStandardDeviation()
+			<< " " << statistics.latency.quantile(0.5)
+			<< " " << statistics.latency.quantile(0.9)
+			<< " " << statistics.latency.quantile(0.99)
+			<< " " << statistics.latency.quantile(0.999)
+			<< " " << statistics.maximumLatency << endl;
+	}
+}
+
+
+MatrixTestSubCommand::MatrixTestSubCommand() {
+	m_name = "test";
+}
+
+void MatrixTestSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running MatrixTestSubCommand" << endl;
+	);
+
+	if (argc != 4) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	stringstream argStream;
+	string matrixFilename;
+	argStream << argv[3];
+	argStream >> matrixFilename;
+	LOG_DEBUG(
+		cout << "DEBUG: argStream " << argStream.str() << endl;
+	);
+
+	try {
+		if (isMatrixBinaryFile(matrixFilename)) {
+			MappedMatrix<double> matrix(matrixFilename);
+
+			cout << matrix.view();
+		}
+		else {
+			Matrix<double> matrix = Matrix<double>::load(matrixFilename);
+
+			cout << matrix;
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+MatrixConvertSubCommand::MatrixConvertSubCommand() {
+	m_name = "convert";
+}
+
+template<class elementType>
+static void convertMatrix(const string& inputFilename, const string& outputFilename, bool toBinary, unsigned int threads) {
+	if (toBinary) {
+		convertMatrixTextToBinary<elementType>(inputFilename, outputFilename, threads);
+	}
+	else {
+		convertMatrixBinaryToText<elementType>(inputFilename, outputFilename);
+	}
+}
+
+void MatrixConvertSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running MatrixConvertSubCommand" << endl;
+	);
+
+	if (argc < 5) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 5, { "type", "threads" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	string inputFilename(argv[3]);
+	string outputFilename(argv[4]);
+	MatrixElementType elementType = MatrixElementType::float64;
+	unsigned int threads = 0;
+	if (options.count("type") && !parseMatrixElementType(options["type"], elementType)) {
+		cout << "ERROR: Unknown element type " << options["type"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	// Binary input is converted to text in its own element type, and text input to binary of the chosen type.
+	try {
+		checkOutputFile(outputFilename, { inputFilename });
+		bool toBinary = !isMatrixBinaryFile(inputFilename);
+		if (!toBinary) {
+			MappedFile inputFile(inputFilename, MappedFile::Mode::read);
+			elementType = static_cast<MatrixElementType>(readMatrixFileHeader(inputFile, inputFilename).elementType);
+		}
+
+		switch (elementType) {
+		case MatrixElementType::float32:
+			convertMatrix<float>(inputFilename, outputFilename, toBinary, threads);
+			break;
+		case MatrixElementType::float64:
+			convertMatrix<double>(inputFilename, outputFilename, toBinary, threads);
+			break;
+		case MatrixElementType::int32:
+			convertMatrix<int32_t>(inputFilename, outputFilename, toBinary, threads);
+			break;
+		case MatrixElementType::int64:
+			convertMatrix<int64_t>(inputFilename, outputFilename, toBinary, threads);
+			break;
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+
+// Memory budget of the out-of-core transpose and map when no --memory is given.
+static const unsigned long long defaultMemoryBudgetMegabytes = 1024;
+
+static bool parseMemoryBudget(unordered_map<string, string>& options, size_t& memoryBudget) {
+	// --memory as a whole number of megabytes, at least 1, leaving memoryBudget unchanged if the option is absent.
+	// Prints an error and returns false otherwise.
+
+	unsigned long long megabytes = 0;
+	if (!parseNumericOption(options, "memory", megabytes)) {
+		return false;
+	}
+	if (options.count("memory")) {
+		if (megabytes == 0 || megabytes > (numeric_limits<size_t>::max() >> 20)) {
+			cout << "ERROR: Invalid --memory " << options["memory"] << "." << endl;
+			return false;
+		}
+		memoryBudget = static_cast<size_t>(megabytes) << 20;
+	}
+	return true;
+}
+
+MatrixMultiplySubCommand::MatrixMultiplySubCommand() {
+	m_name = "multiply";
+}
+
+template<class elementType>
+static MatrixView<elementType> openMatrix(
+	const string& filename, unsigned int threads,
+	unique_ptr<MappedMatrix<elementType>>& mapped, unique_ptr<Matrix<elementType>>& loaded) {
+	// Map a binary matrix in place or parse a text one, returning a view of whichever holds the elements.
+
+	if (isMatrixBinaryFile(filename)) {
+		mapped.reset(new MappedMatrix<elementType>(filename));
+		return mapped->view();
+	}
+
+	loaded.reset(new Matrix<elementType>(Matrix<elementType>::load(filename, threads)));
+	return loaded->view();
+}
+
+template<class elementType>
+static void multiplyMatrices(
+	const string& aFilename, const string& bFilename, const string& outputFilename,
+	Transpose transposeA, Transpose transposeB, unsigned int threads) {
+	if (!outputFilename.empty()) {
+		checkOutputFile(outputFilename, { aFilename, bFilename });
+	}
+	unique_ptr<MappedMatrix<elementType>> mappedA, mappedB;
+	unique_ptr<Matrix<elementType>> loadedA, loadedB;
+	MatrixView<elementType> a = openMatrix(aFilename, threads, mappedA, loadedA);
+	MatrixView<elementType> b = openMatrix(bFilename, threads, mappedB, loadedB);
+
+	auto start = chrono::steady_clock::now();
+	Matrix<elementType> product = multiply(a, b, transposeA, transposeB, threads);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	if (outputFilename.empty()) {
+		cout << product;
+		return;
+	}
+
+	saveMatrixBinary(product.view(), outputFilename);
+
+	unsigned long k = transposeA == Transpose::yes ? a.nRows() : a.nCols();
+	double flops = 2.0 * product.nRows() * product.nCols() * k;
+	cout << "Multiplied " << product.nRows() << "x" << k << " by " << k << "x" << product.nCols()
+		<< " in " << elapsed.count() << " s, " << flops / elapsed.count() / 1e9 << " GFLOP/s." << endl;
+}
+
+template<class elementType>
+static void multiplyMatrixFilesTimed(
+	const string& aFilename, const string& bFilename, const string& outputFilename,
+	Transpose transposeA, Transpose transposeB, size_t memoryBudget, unsigned int threads) {
+	auto start = chrono::steady_clock::now();
+	multiplyMatrixFiles<elementType>(aFilename, bFilename, outputFilename, transposeA, transposeB, memoryBudget, threads);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	MappedMatrix<elementType> a(aFilename), c(outputFilename);
+	unsigned long k = transposeA == Transpose::yes ? a.nRows() : a.nCols();
+	double flops = 2.0 * c.nRows() * c.nCols() * k;
+	cout << "Multiplied " << c.nRows() << "x" << k << " by " << k << "x" << c.nCols() << " out of core in "
+		<< elapsed.count() << " s, " << flops / elapsed.count() / 1e9 << " GFLOP/s." << endl;
+}
+
+void MatrixMultiplySubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running MatrixMultiplySubCommand" << endl;
+	);
+
+	if (argc < 5) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 5, { "output", "transpose-a", "transpose-b", "type", "threads", "memory" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	string aFilename(argv[3]);
+	string bFilename(argv[4]);
+	string outputFilename = options.count("output") ? options["output"] : "";
+	Transpose transposeA = options.count("transpose-a") && options["transpose-a"] == "yes" ? Transpose::yes : Transpose::no;
+	Transpose transposeB = options.count("transpose-b") && options["transpose-b"] == "yes" ? Transpose::yes : Transpose::no;
+	MatrixElementType elementType = MatrixElementType::float64;
+	unsigned int threads = 0;
+	if (options.count("type") && !parseMatrixElementType(options["type"], elementType)) {
+		cout << "ERROR: Unknown element type " << options["type"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+	size_t memoryBudget = 0;
+	if (!parseMemoryBudget(options, memoryBudget)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (memoryBudget != 0 && outputFilename.empty()) {
+		cout << "ERROR: An out-of-core multiply needs --output." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	// A binary input fixes the element type; MappedMatrix rejects the other input if it holds a different type.
+	try {
+		for (const string& filename : { aFilename, bFilename }) {
+			if (isMatrixBinaryFile(filename)) {
+				MappedFile inputFile(filename, MappedFile::Mode::read);
+				elementType = static_cast<MatrixElementType>(readMatrixFileHeader(inputFile, filename).elementType);
+				break;
+			}
+		}
+
+		switch (elementType) {
+		case MatrixElementType::float32:
+			if (memoryBudget != 0) {
+				multiplyMatrixFilesTimed<float>(aFilename, bFilename, outputFilename, transposeA, transposeB, memoryBudget, threads);
+			}
+			else {
+				multiplyMatrices<float>(aFilename, bFilename, outputFilename, transposeA, transposeB, threads);
+			}
+			break;
+		case MatrixElementType::float64:
+			if (memoryBudget != 0) {
+				multiplyMatrixFilesTimed<double>(aFilename, bFilename, outputFilename, transposeA, transposeB, memoryBudget, threads);
+			}
+			else {
+				multiplyMatrices<double>(aFilename, bFilename, outputFilename, transposeA, transposeB, threads);
+			}
+			break;
+		default:
+			cout << "ERROR: Only float32 and float64 matrices can be multiplied." << endl;
+			break;
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+MatrixSparseMultiplySubCommand::MatrixSparseMultiplySubCommand() {
+	m_name = "spmv";
+}
+
+template<SparseLayout layout>
+static void multiplySparseMatrix(
+	const CompressedSparseMatrix<double, layout>& a, const MatrixView<double>& x, const string& outputFilename,
+	unsigned int threads) {
+	auto start = chrono::steady_clock::now();
+	Matrix<double> y = multiply(a, x, threads);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	if (outputFilename.empty()) {
+		cout << y;
+		return;
+	}
+
+	saveMatrixBinary(y.view(), outputFilename);
+
+	double flops = 2.0 * a.nonZeros() * x.nCols();
+	cout << "Multiplied " << a.nRows() << "x" << a.nCols() << " sparse matrix with " << a.nonZeros()
+		<< " non-zeros by " << x.nRows() << "x" << x.nCols() << " in " << elapsed.count() << " s, "
+		<< flops / elapsed.count() / 1e9 << " GFLOP/s." << endl;
+}
+
+void MatrixSparseMultiplySubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running MatrixSparseMultiplySubCommand" << endl;
+	);
+
+	if (argc < 5) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 5, { "layout", "output", "threads" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	string aFilename(argv[3]);
+	string xFilename(argv[4]);
+	string outputFilename = options.count("output") ? options["output"] : "";
+	string layout = options.count("layout") ? options["layout"] : "csr";
+	unsigned int threads = 0;
+	if (layout != "csr" && layout != "csc") {
+		cout << "ERROR: Unknown sparse layout " << layout << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	try {
+		if (!outputFilename.empty()) {
+			checkOutputFile(outputFilename, { aFilename, xFilename });
+		}
+		CsrMatrix<double> a = loadMatrixMarket<double>(aFilename);
+		unique_ptr<MappedMatrix<double>> mappedX;
+		unique_ptr<Matrix<double>> loadedX;
+		MatrixView<double> x = openMatrix(xFilename, threads, mappedX, loadedX);
+
+		if (layout == "csc") {
+			multiplySparseMatrix(toCsc(a), x, outputFilename, threads);
+		}
+		else {
+			multiplySparseMatrix(a, x, outputFilename, threads);
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+MatrixSolveSubCommand::MatrixSolveSubCommand() {
+	m_name = "solve";
+}
+
+template<class Factorization>
+static void solveMatrix(
+	const MatrixView<double>& a, const MatrixView<double>& b, const string& outputFilename, unsigned int threads) {
+	auto start = chrono::steady_clock::now();
+	Factorization factorization(a, threads);
+	chrono::duration<double> factorized = chrono::steady_clock::now() - start;
+
+	start = chrono::steady_clock::now();
+	Matrix<double> x = factorization.solve(b, threads);
+	chrono::duration<double> solved = chrono::steady_clock::now() - start;
+
+	if (outputFilename.empty()) {
+		cout << x;
+		return;
+	}
+
+	saveMatrixBinary(x.view(), outputFilename);
+
+	Matrix<double> residual = multiply(a, x.view(), Transpose::no, Transpose::no, threads) - b;
+	cout << "Factorized " << a.nRows() << "x" << a.nCols() << " in " << factorized.count() << " s and solved for "
+		<< b.nCols() << " right-hand sides in " << solved.count() << " s, relative residual "
+		<< frobeniusNorm(residual) / (frobeniusNorm(a) * frobeniusNorm(x)) << "." << endl;
+}
+
+void MatrixSolveSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running MatrixSolveSubCommand" << endl;
+	);
+
+	if (argc < 5) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 5, { "method", "output", "threads" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	string aFilename(argv[3]);
+	string bFilename(argv[4]);
+	string outputFilename = options.count("output") ? options["output"] : "";
+	string method = options.count("method") ? options["method"] : "lu";
+	unsigned int threads = 0;
+	if (method != "lu" && method != "cholesky") {
+		cout << "ERROR: Unknown factorization " << method << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	try {
+		if (!outputFilename.empty()) {
+			checkOutputFile(outputFilename, { aFilename, bFilename });
+		}
+		unique_ptr<MappedMatrix<double>> mappedA, mappedB;
+		unique_ptr<Matrix<double>> loadedA, loadedB;
+		MatrixView<double> a = openMatrix(aFilename, threads, mappedA, loadedA);
+		MatrixView<double> b = openMatrix(bFilename, threads, mappedB, loadedB);
+
+		if (method == "cholesky") {
+			solveMatrix<CholeskyFactorization<double>>(a, b, outputFilename, threads);
+		}
+		else {
+			solveMatrix<LuFactorization<double>>(a, b, outputFilename, threads);
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+MatrixTransposeSubCommand::MatrixTransposeSubCommand() {
+	m_name = "transpose";
+}
+
+template<class elementType>
+static void transposeMatrixFileTimed(
+	const string& inputFilename, const string& outputFilename, size_t memoryBudget, unsigned int threads) {
+	auto start = chrono::steady_clock::now();
+	transposeMatrixFile<elementType>(inputFilename, outputFilename, memoryBudget, threads);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	MappedMatrix<elementType> output(outputFilename);
+	double megabytes = static_cast<double>(output.nRows()) * output.nCols() * sizeof(elementType) / (1 << 20);
+	cout << "Transposed " << output.nCols() << "x" << output.nRows() << " in " << elapsed.count() << " s, "
+		<< megabytes / elapsed.count() << " MB/s." << endl;
+}
+
+void MatrixTransposeSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running MatrixTransposeSubCommand" << endl;
+	);
+
+	if (argc < 5) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 5, { "memory", "threads" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	string inputFilename(argv[3]);
+	string outputFilename(argv[4]);
+	size_t memoryBudget = static_cast<size_t>(defaultMemoryBudgetMegabytes) << 20;
+	unsigned int threads = 0;
+	if (!parseMemoryBudget(options, memoryBudget)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	try {
+		PositionalFile inputFile(inputFilename, PositionalFile::Mode::read);
+		MatrixElementType elementType = static_cast<MatrixElementType>(readMatrixFileHeader(inputFile).elementType);
+		inputFile.close();
+
+		switch (elementType) {
+		case MatrixElementType::float32:
+			transposeMatrixFileTimed<float>(inputFilename, outputFilename, memoryBudget, threads);
+			break;
+		case MatrixElementType::float64:
+			transposeMatrixFileTimed<double>(inputFilename, outputFilename, memoryBudget, threads);
+			break;
+		case MatrixElementType::int32:
+			transposeMatrixFileTimed<int32_t>(inputFilename, outputFilename, memoryBudget, threads);
+			break;
+		case MatrixElementType::int64:
+			transposeMatrixFileTimed<int64_t>(inputFilename, outputFilename, memoryBudget, threads);
+			break;
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
+
+
+MatrixMapSubCommand::MatrixMapSubCommand() {
+	m_name = "map";
+}
+
+template<class elementType>
+static void mapMatrixFileTimed(const string& inputFilename, const string& outputFilename,
+	const string& function, double argument, size_t memoryBudget, unsigned int threads) {
+	auto start = chrono::steady_clock::now();
+	elementType value = static_cast<elementType>(argument);
+	if (function == "abs") {
+		mapMatrixFile<elementType>(inputFilename, outputFilename, [](elementType x) { return abs(x); }, memoryBudget, threads);
+	}
+	else if (function == "sqrt") {
+		mapMatrixFile<elementType>(inputFilename, outputFilename, [](elementType x) { return sqrt(x); }, memoryBudget, threads);
+	}
+	else if (function == "exp") {
+		mapMatrixFile<elementType>(inputFilename, outputFilename, [](elementType x) { return exp(x); }, memoryBudget, threads);
+	}
+	else if (function == "log") {
+		mapMatrixFile<elementType>(inputFilename, outputFilename, [](elementType x) { return log(x); }, memoryBudget, threads);
+	}
+	else if (function == "square") {
+		mapMatrixFile<elementType>(inputFilename, outputFilename, [](elementType x) { return x * x; }, memoryBudget, threads);
+	}
+	else if (function == "scale") {
+		mapMatrixFile<elementType>(inputFilename, outputFilename, [value](elementType x) { return x * value; }, memoryBudget, threads);
+	}
+	else {
+		mapMatrixFile<elementType>(inputFilename, outputFilename, [value](elementType x) { return x + value; }, memoryBudget, threads);
+	}
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	MappedMatrix<elementType> output(outputFilename);
+	double megabytes = static_cast<double>(output.nRows()) * output.nCols() * sizeof(elementType) / (1 << 20);
+	cout << "Mapped " << output.nRows() << "x" << output.nCols() << " in " << elapsed.count() << " s, "
+		<< megabytes / elapsed.count() << " MB/s." << endl;
+}
+
+void MatrixMapSubCommand::run(int argc, char** argv) {
+	LOG_DEBUG(
+		cout << "DEBUG: Running MatrixMapSubCommand" << endl;
+	);
+
+	if (argc < 5) {
+		cout << "ERROR: Wrong number of arguments." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	unordered_map<string, string> options;
+	if (!parseOptions(argc, argv, 5, { "function", "memory", "threads" }, options)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	string inputFilename(argv[3]);
+	string outputFilename(argv[4]);
+	size_t memoryBudget = static_cast<size_t>(defaultMemoryBudgetMegabytes) << 20;
+	unsigned int threads = 0;
+	if (!options.count("function")) {
+		cout << "ERROR: Missing --function." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	// name, or name:argument for scale and add.
+	string function = options["function"];
+	double argument = 0;
+	size_t colon = function.find(':');
+	bool takesArgument = false;
+	if (colon != string::npos) {
+		stringstream stream(function.substr(colon + 1));
+		function = function.substr(0, colon);
+		takesArgument = true;
+		if (!(stream >> argument) || !stream.eof()) {
+			function.clear();
+		}
+	}
+	bool known = function == "abs" || function == "sqrt" || function == "exp" || function == "log" || function == "square";
+	if (takesArgument ? function != "scale" && function != "add" : !known) {
+		cout << "ERROR: Unknown function " << options["function"] << "." << endl;
+		printUsage(argc, argv);
+		return;
+	}
+
+	if (!parseMemoryBudget(options, memoryBudget)) {
+		printUsage(argc, argv);
+		return;
+	}
+	if (!parseNumericOption(options, "threads", threads)) {
+		printUsage(argc, argv);
+		return;
+	}
+
+	try {
+		PositionalFile inputFile(inputFilename, PositionalFile::Mode::read);
+		MatrixElementType elementType = static_cast<MatrixElementType>(readMatrixFileHeader(inputFile).elementType);
+		inputFile.close();
+
+		switch (elementType) {
+		case MatrixElementType::float32:
+			mapMatrixFileTimed<float>(inputFilename, outputFilename, function, argument, memoryBudget, threads);
+			break;
+		case MatrixElementType::float64:
+			mapMatrixFileTimed<double>(inputFilename, outputFilename, function, argument, memoryBudget, threads);
+			break;
+		default:
+			cout << "ERROR: Only float32 and float64 matrices can be mapped." << endl;
+			break;
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+	}
+}
 
 
 CommandDispatcher::CommandDispatcher(
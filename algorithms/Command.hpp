@@ -15,6 +15,11 @@ public:
 
 protected:
 	std::string m_name;
+
+	static bool parseOptions(
+		int argc, char** argv, int firstOption,
+		const std::vector<std::string>& allowedOptions,
+		std::unordered_map<std::string, std::string>& options);
 };
 
 std::ostream& operator<<(std::ostream& os, const Command& command);
@@ -53,6 +58,22 @@ public:
 };
 
 
+class PoissonProcessQuantileSubCommand : public Command {
+public:
+	PoissonProcessQuantileSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+
+class PoissonProcessPMFTableSubCommand : public Command {
+public:
+	PoissonProcessPMFTableSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+
 class PoissonProcessSampleArrivalTimesSubCommand : public Command {
 public:
 	PoissonProcessSampleArrivalTimesSubCommand();
@@ -61,6 +82,14 @@ public:
 };
 
 
+class PoissonProcessSampleInterArrivalTimesSubCommand : public Command {
+public:
+	PoissonProcessSampleInterArrivalTimesSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+
 class PoissonProcessSampleNumberArrivalsSubCommand : public Command {
 public:
 	PoissonProcessSampleNumberArrivalsSubCommand();
@@ -69,6 +98,30 @@ public:
 };
 
 
+class PoissonProcessSuperposeSubCommand : public Command {
+public:
+	PoissonProcessSuperposeSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+
+class PoissonProcessSampleProfileArrivalTimesSubCommand : public Command {
+public:
+	PoissonProcessSampleProfileArrivalTimesSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+
+class PoissonProcessSimulateQueueSubCommand : public Command {
+public:
+	PoissonProcessSimulateQueueSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+
 class MatrixTestSubCommand : public Command {
 public:
 	MatrixTestSubCommand();
@@ -76,6 +129,48 @@ public:
 	virtual void run(int argc, char** argv);
 };
 
+class MatrixConvertSubCommand : public Command {
+public:
+	MatrixConvertSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+class MatrixMultiplySubCommand : public Command {
+public:
+	MatrixMultiplySubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+class MatrixSparseMultiplySubCommand : public Command {
+public:
+	MatrixSparseMultiplySubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+class MatrixSolveSubCommand : public Command {
+public:
+	MatrixSolveSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+class MatrixTransposeSubCommand : public Command {
+public:
+	MatrixTransposeSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
+class MatrixMapSubCommand : public Command {
+public:
+	MatrixMapSubCommand();
+
+	virtual void run(int argc, char** argv);
+};
+
 class GridWorldTestSubCommand : public Command {
 public:
 	GridWorldTestSubCommand();
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "MatrixExpression.hpp"
+#include "MatrixView.hpp"
+
+
+// Call body(std::integral_constant<size_t, i>()) for each index, as a sequence of calls with no loop left to run.
+template<class Body, size_t... indices>
+inline void unrollMatrixLoop(std::index_sequence<indices...>, const Body& body) {
+	(body(std::integral_constant<size_t, indices>()), ...);
+}
+
+// Call body(i) for i = 0..count-1, each i a compile-time constant.
+template<size_t count, class Body>
+inline void unrollMatrixLoop(const Body& body) {
+	unrollMatrixLoop(std::make_index_sequence<count>(), body);
+}
+
+
+// Small matrix whose dimensions are part of its type. The elements are held inline in row-major order, so it needs no
+// allocation and every loop over it has a constant trip count, and element-wise arithmetic, multiply, transpose,
+// determinant and inverse are unrolled at compile time. It converts to and from the dynamic Matrix<T> through
+// MatrixExpression, the conversion checking the dimensions at run time.
+template<class elementType, size_t rows, size_t cols>
+class Matrix : public MatrixExpression<Matrix<elementType, rows, cols>> {
+	static_assert(rows != matrixDynamicExtent && cols != matrixDynamicExtent,
+		"A matrix must have both dimensions fixed or both dynamic.");
+
+public:
+	typedef elementType value_type;
+
+	// Zero matrix.
+	Matrix() :
+		elements{} {}
+
+	// Matrix of the row-major elements in data.
+	explicit Matrix(const std::array<elementType, rows * cols>& data) :
+		elements(data) {}
+
+	// Copy of a dynamic matrix, view or expression. Throws std::runtime_error if its dimensions differ.
+	template<class Expression>
+	explicit Matrix(const MatrixExpression<Expression>& expression) {
+		if (expression.nRows() != rows || expression.nCols() != cols) {
+			throw std::runtime_error("Cannot make a " + std::to_string(rows) + "x" + std::to_string(cols) +
+				" matrix from a " + std::to_string(expression.nRows()) + "x" + std::to_string(expression.nCols()) +
+				" matrix.");
+		}
+		const Expression& e = expression.derived();
+		for (unsigned long row = 0; row < rows; ++row) {
+			for (unsigned long col = 0; col < cols; ++col) {
+				elements[row * cols + col] = e(row, col);
+			}
+		}
+	}
+
+	static Matrix identity() {
+		static_assert(rows == cols, "Only a square matrix has an identity.");
+		Matrix result;
+		unrollMatrixLoop<rows>([&](auto i) { result.elements[i * cols + i] = 1; });
+		return result;
+	}
+
+	elementType operator()(unsigned long row, unsigned long col) const {
+		return elements[row * cols + col];
+	}
+
+	elementType& operator()(unsigned long row, unsigned long col) {
+		return elements[row * cols + col];
+	}
+
+	const elementType* data() const {
+		return elements.data();
+	}
+
+	elementType* data() {
+		return elements.data();
+	}
+
+	MatrixView<elementType> view() const {
+		return MatrixView<elementType>(elements.data(), rows, cols);
+	}
+
+	static constexpr unsigned long nRows() {
+		return rows;
+	}
+
+	static constexpr unsigned long nCols() {
+		return cols;
+	}
+
+	// A fixed-size matrix holds its own elements, so it never reads those of another matrix.
+	bool readsWithin(const void*, const void*) const {
+		return false;
+	}
+
+	Matrix<elementType, cols, rows> transpose() const {
+		Matrix<elementType, cols, rows> result;
+		unrollMatrixLoop<rows>([&](auto row) {
+			unrollMatrixLoop<cols>([&](auto col) { result(col, row) = elements[row * cols + col]; });
+		});
+		return result;
+	}
+
+	Matrix& operator+=(const Matrix& other) {
+		unrollMatrixLoop<rows * cols>([&](auto i) { elements[i] += other.elements[i]; });
+		return *this;
+	}
+
+	Matrix& operator-=(const Matrix& other) {
+		unrollMatrixLoop<rows * cols>([&](auto i) { elements[i] -= other.elements[i]; });
+		return *this;
+	}
+
+	Matrix& operator*=(elementType scalar) {
+		unrollMatrixLoop<rows * cols>([&](auto i) { elements[i] *= scalar; });
+		return *this;
+	}
+
+private:
+	std::array<elementType, rows * cols> elements;
+};
+
+
+// Matrix<elementType, rows, cols> when both dimensions are fixed. As a return type it removes the fixed-size overloads
+// below for dynamic matrices, which would otherwise match them with rows and cols equal to matrixDynamicExtent.
+template<class elementType, size_t rows, size_t cols>
+using FixedMatrix = std::enable_if_t<
+	rows != matrixDynamicExtent && cols != matrixDynamicExtent, Matrix<elementType, rows, cols>>;
+
+// Arithmetic between fixed-size matrices is eager rather than lazy: the result is only a few registers, and returning
+// it by value lets the compiler keep whole chains of operations in registers.
+template<class elementType, size_t rows, size_t cols>
+FixedMatrix<elementType, rows, cols> operator+(
+	const Matrix<elementType, rows, cols>& left, const Matrix<elementType, rows, cols>& right) {
+	Matrix<elementType, rows, cols> result = left;
+	return result += right;
+}
+
+template<class elementType, size_t rows, size_t cols>
+FixedMatrix<elementType, rows, cols> operator-(
+	const Matrix<elementType, rows, cols>& left, const Matrix<elementType, rows, cols>& right) {
+	Matrix<elementType, rows, cols> result = left;
+	return result -= right;
+}
+
+template<class elementType, size_t rows, size_t cols>
+FixedMatrix<elementType, rows, cols> operator-(const Matrix<elementType, rows, cols>& operand) {
+	Matrix<elementType, rows, cols> result = operand;
+	return result *= elementType(-1);
+}
+
+template<class elementType, size_t rows, size_t cols>
+FixedMatrix<elementType, rows, cols> operator*(
+	const Matrix<elementType, rows, cols>& operand, typename Matrix<elementType, rows, cols>::value_type scalar) {
+	Matrix<elementType, rows, cols> result = operand;
+	return result *= scalar;
+}
+
+template<class elementType, size_t rows, size_t cols>
+FixedMatrix<elementType, rows, cols> operator*(
+	typename Matrix<elementType, rows, cols>::value_type scalar, const Matrix<elementType, rows, cols>& operand) {
+	Matrix<elementType, rows, cols> result = operand;
+	return result *= scalar;
+}
+
+template<class elementType, size_t rows, size_t cols>
+FixedMatrix<elementType, rows, cols> operator/(
+	const Matrix<elementType, rows, cols>& operand, typename Matrix<elementType, rows, cols>::value_type scalar) {
+	Matrix<elementType, rows, cols> result = operand;
+	return result *= elementType(1) / scalar;
+}
+
+// Matrix product, every multiply-add unrolled.
+template<class elementType, size_t rows, size_t inner, size_t cols>
+FixedMatrix<elementType, rows, cols> multiply(
+	const Matrix<elementType, rows, inner>& left, const Matrix<elementType, inner, cols>& right) {
+	Matrix<elementType, rows, cols> product;
+	unrollMatrixLoop<rows>([&](auto row) {
+		unrollMatrixLoop<cols>([&](auto col) {
+			elementType sum = 0;
+			unrollMatrixLoop<inner>([&](auto k) { sum += left(row, k) * right(k, col); });
+			product(row, col) = sum;
+		});
+	});
+	return product;
+}
+
+template<class elementType, size_t size>
+std::enable_if_t<size != matrixDynamicExtent, elementType> determinant(const Matrix<elementType, size, size>& matrix) {
+	// Closed forms up to 3x3, and elimination with partial pivoting beyond, its column, pivot search and row loops all
+	// unrolled so only the choice of pivot row is made at run time.
+
+	const Matrix<elementType, size, size>& m = matrix;
+	if constexpr (size == 1) {
+		return m(0, 0);
+	}
+	else if constexpr (size == 2) {
+		return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+	}
+	else if constexpr (size == 3) {
+		return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1))
+			+ m(0, 1) * (m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2))
+			+ m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+	}
+	else {
+		// A pivot of zero sets result to zero, after which the remaining columns are skipped.
+		Matrix<elementType, size, size> lu = matrix;
+		elementType result = 1;
+		unrollMatrixLoop<size>([&](auto col) {
+			if (result == 0) {
+				return;
+			}
+			size_t pivot = col;
+			unrollMatrixLoop<size>([&](auto row) {
+				if (row > col && std::abs(lu(row, col)) > std::abs(lu(pivot, col))) {
+					pivot = row;
+				}
+			});
+			if (lu(pivot, col) == 0) {
+				result = 0;
+				return;
+			}
+			if (pivot != col) {
+				unrollMatrixLoop<size>([&](auto k) { std::swap(lu(pivot, k), lu(col, k)); });
+				result = -result;
+			}
+			result *= lu(col, col);
+			unrollMatrixLoop<size>([&](auto row) {
+				if (row > col) {
+					elementType factor = lu(row, col) / lu(col, col);
+					unrollMatrixLoop<size>([&](auto k) {
+						if (k > col) {
+							lu(row, k) -= factor * lu(col, k);
+						}
+					});
+				}
+			});
+		});
+		return result;
+	}
+}
+
+template<class elementType, size_t size>
+FixedMatrix<elementType, size, size> inverse(const Matrix<elementType, size, size>& matrix) {
+	// Closed forms through the adjugate up to 3x3, and Gauss-Jordan elimination with partial pivoting beyond, unrolled
+	// like the elimination in determinant. Throws std::runtime_error if the matrix is singular.
+
+	const Matrix<elementType, size, size>& m = matrix;
+	auto singular = []() {
+		return std::runtime_error("Cannot invert a singular " + std::to_string(size) + "x" + std::to_string(size) + " matrix.");
+	};
+
+	Matrix<elementType, size, size> result;
+	if constexpr (size <= 3) {
+		elementType det = determinant(m);
+		if (det == 0) {
+			throw singular();
+		}
+		elementType scale = elementType(1) / det;
+		if constexpr (size == 1) {
+			result(0, 0) = scale;
+		}
+		else if constexpr (size == 2) {
+			result = Matrix<elementType, 2, 2>({ m(1, 1), -m(0, 1), -m(1, 0), m(0, 0) }) * scale;
+		}
+		else {
+			result = Matrix<elementType, 3, 3>({
+				m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1), m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2), m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1),
+				m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2), m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0), m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2),
+				m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0), m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1), m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)
+				}) * scale;
+		}
+	}
+	else {
+		Matrix<elementType, size, size> left = m;
+		result = Matrix<elementType, size, size>::identity();
+		unrollMatrixLoop<size>([&](auto col) {
+			size_t pivot = col;
+			unrollMatrixLoop<size>([&](auto row) {
+				if (row > col && std::abs(left(row, col)) > std::abs(left(pivot, col))) {
+					pivot = row;
+				}
+			});
+			if (left(pivot, col) == 0) {
+				throw singular();
+			}
+			if (pivot != col) {
+				unrollMatrixLoop<size>([&](auto k) {
+					std::swap(left(pivot, k), left(col, k));
+					std::swap(result(pivot, k), result(col, k));
+				});
+			}
+			elementType scale = elementType(1) / left(col, col);
+			unrollMatrixLoop<size>([&](auto k) {
+				left(col, k) *= scale;
+				result(col, k) *= scale;
+			});
+			unrollMatrixLoop<size>([&](auto row) {
+				if (row != col) {
+					elementType factor = left(row, col);
+					unrollMatrixLoop<size>([&](auto k) {
+						left(row, k) -= factor * left(col, k);
+						result(row, k) -= factor * result(col, k);
+					});
+				}
+			});
+		});
+	}
+	return result;
+}
+
+template<class elementType, size_t rows, size_t cols>
+std::enable_if_t<rows != matrixDynamicExtent, std::ostream&> operator<<(
+	std::ostream& os, const Matrix<elementType, rows, cols>& matrix) {
+	return os << matrix.view();
+}
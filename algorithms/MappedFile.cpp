@@ -0,0 +1,160 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile() :
+	address(nullptr),
+	length(0),
+#ifdef _WIN32
+	fileHandle(nullptr),
+	mappingHandle(nullptr) {}
+#else
+	descriptor(-1) {}
+#endif
+
+
+MappedFile::MappedFile(const string& filename, Mode mode, size_t createSize) : MappedFile() {
+	bool create = mode == Mode::create;
+	bool writable = mode != Mode::read;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		filename.c_str(),
+		writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		create ? CREATE_ALWAYS : OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw runtime_error("Cannot open " + filename + ".");
+	}
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (create) {
+		fileSize.QuadPart = static_cast<LONGLONG>(createSize);
+	}
+	else if (!GetFileSizeEx(file, &fileSize)) {
+		close();
+		throw runtime_error("Cannot read size of " + filename + ".");
+	}
+	length = static_cast<size_t>(fileSize.QuadPart);
+	if (length == 0) {
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingA(
+		file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, fileSize.HighPart, fileSize.LowPart, nullptr);
+	if (mapping == nullptr) {
+		close();
+		throw runtime_error("Cannot map " + filename + ".");
+	}
+	mappingHandle = mapping;
+
+	address = static_cast<char*>(MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+	if (address == nullptr) {
+		close();
+		throw runtime_error("Cannot map " + filename + ".");
+	}
+#else
+	descriptor = create ? open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) :
+		open(filename.c_str(), writable ? O_RDWR : O_RDONLY);
+	if (descriptor < 0) {
+		throw runtime_error("Cannot open " + filename + ".");
+	}
+
+	if (create) {
+		if (ftruncate(descriptor, static_cast<off_t>(createSize)) != 0) {
+			close();
+			throw runtime_error("Cannot resize " + filename + ".");
+		}
+		length = createSize;
+	}
+	else {
+		struct stat fileStatus;
+		if (fstat(descriptor, &fileStatus) != 0) {
+			close();
+			throw runtime_error("Cannot read size of " + filename + ".");
+		}
+		length = static_cast<size_t>(fileStatus.st_size);
+	}
+	if (length == 0) {
+		return;
+	}
+
+	void* mapped = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+	if (mapped == MAP_FAILED) {
+		close();
+		throw runtime_error("Cannot map " + filename + ".");
+	}
+	address = static_cast<char*>(mapped);
+#endif
+}
+
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile() {
+	*this = move(other);
+}
+
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		swap(address, other.address);
+		swap(length, other.length);
+#ifdef _WIN32
+		swap(fileHandle, other.fileHandle);
+		swap(mappingHandle, other.mappingHandle);
+#else
+		swap(descriptor, other.descriptor);
+#endif
+	}
+
+	return *this;
+}
+
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (address != nullptr) {
+		UnmapViewOfFile(address);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+	}
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (address != nullptr) {
+		munmap(address, length);
+	}
+	if (descriptor >= 0) {
+		::close(descriptor);
+	}
+	descriptor = -1;
+#endif
+	address = nullptr;
+	length = 0;
+}
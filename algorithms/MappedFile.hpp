@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+// Memory mapping of a whole file: read-only, read-write for an existing file, or as a new file of a given size that is
+// created or truncated. Writable mappings are shared, so writes reach the file.
+// Throws std::runtime_error if the file cannot be opened or mapped. The mapping is released on destruction.
+class MappedFile {
+public:
+	enum class Mode { read, readWrite, create };
+
+	MappedFile();
+	MappedFile(const std::string& filename, Mode mode, size_t createSize = 0);
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	char* data() {
+		return address;
+	}
+
+	const char* data() const {
+		return address;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+	void close();
+
+private:
+	char* address;
+	size_t length;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int descriptor;
+#endif
+};
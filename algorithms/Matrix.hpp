@@ -5,52 +5,180 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 
+#include "MatrixAllocator.hpp"
+#include "MatrixText.hpp"
+#include "MatrixView.hpp"
+#include "MatrixExpression.hpp"
+#include "FixedMatrix.hpp"
 
+
+// Dense row-major matrix owning its elements, which start on a matrixAlignment boundary and come from the memory
+// resource of its MatrixAllocator. Rows, columns, blocks and the transpose are read without copying through view().
+// Its dimensions are chosen at run time; FixedMatrix.hpp has Matrix<T, rows, cols> for small matrices of known size.
 template<class elementType>
-class Matrix {
+class Matrix<elementType, matrixDynamicExtent, matrixDynamicExtent> : public MatrixExpression<Matrix<elementType>> {
 public:
-	Matrix(unsigned long dataRows, unsigned long dataCols, const std::vector<elementType>& data) :
+	typedef elementType value_type;
+	typedef MatrixAllocator<elementType> allocator_type;
+
+	// Zero-filled matrix.
+	Matrix(unsigned long dataRows, unsigned long dataCols, const allocator_type& allocator = allocator_type()) :
+		dim(dataRows, dataCols),
+		elements(static_cast<size_t>(dataRows) * dataCols, elementType(), allocator) {}
+
+	// Copy of the row-major elements in data, into aligned storage.
+	Matrix(unsigned long dataRows, unsigned long dataCols, const std::vector<elementType>& data,
+		const allocator_type& allocator = allocator_type()) :
+		dim(dataRows, dataCols),
+		elements(data.begin(), data.end(), allocator) {}
+
+	// Take over the row-major elements in data without copying.
+	Matrix(unsigned long dataRows, unsigned long dataCols, MatrixStorage<elementType>&& data) :
 		dim(dataRows, dataCols),
-		elements(data) {}
+		elements(std::move(data)) {}
+
+	// Evaluate an element-wise expression, such as 2 * a + b, in a single pass.
+	template<class Expression>
+	Matrix(const MatrixExpression<Expression>& expression, const allocator_type& allocator = allocator_type()) :
+		dim(expression.nRows(), expression.nCols()),
+		elements(static_cast<size_t>(expression.nRows()) * expression.nCols(), allocator) {
+		assign(expression.derived(), [](elementType& element, elementType value) { element = value; });
+	}
+
+	// Assignments evaluate into a temporary first if a view in the expression reads this matrix's elements, such as
+	// a = a.view().transpose(), which would otherwise read elements already overwritten or, on a resize, freed.
+	template<class Expression>
+	Matrix& operator=(const MatrixExpression<Expression>& expression) {
+		if (readsElements(expression)) {
+			Matrix result(expression, get_allocator());
+			dim = result.dim;
+			elements = std::move(result.elements);
+			return *this;
+		}
+		if (dim.first != expression.nRows() || dim.second != expression.nCols()) {
+			dim = std::make_pair(expression.nRows(), expression.nCols());
+			elements.resize(static_cast<size_t>(dim.first) * dim.second);
+		}
+		assign(expression.derived(), [](elementType& element, elementType value) { element = value; });
+		return *this;
+	}
+
+	template<class Expression>
+	Matrix& operator+=(const MatrixExpression<Expression>& expression) {
+		requireDimensions(expression.nRows(), expression.nCols());
+		if (readsElements(expression)) {
+			assign(Matrix(expression, get_allocator()), [](elementType& element, elementType value) { element += value; });
+		}
+		else {
+			assign(expression.derived(), [](elementType& element, elementType value) { element += value; });
+		}
+		return *this;
+	}
+
+	template<class Expression>
+	Matrix& operator-=(const MatrixExpression<Expression>& expression) {
+		requireDimensions(expression.nRows(), expression.nCols());
+		if (readsElements(expression)) {
+			assign(Matrix(expression, get_allocator()), [](elementType& element, elementType value) { element -= value; });
+		}
+		else {
+			assign(expression.derived(), [](elementType& element, elementType value) { element -= value; });
+		}
+		return *this;
+	}
+
+	Matrix& operator*=(elementType scalar) {
+		for (auto& element : elements) {
+			element *= scalar;
+		}
+		return *this;
+	}
 
 	elementType operator()(unsigned long row, unsigned long col) const {
-		return elements[dim.first*row + col];
+		return elements[static_cast<size_t>(row) * dim.second + col];
 	}
 
-	static Matrix<elementType> load(const std::string& filename);
+	elementType& operator()(unsigned long row, unsigned long col) {
+		return elements[static_cast<size_t>(row) * dim.second + col];
+	}
 
-	unsigned long nRows() {
+	const elementType* data() const {
+		return elements.data();
+	}
+
+	elementType* data() {
+		return elements.data();
+	}
+
+	MatrixView<elementType> view() const {
+		return MatrixView<elementType>(elements.data(), dim.first, dim.second);
+	}
+
+	// Load a matrix from text, parsing on threads threads, 0 for one per core, straight into the matrix's storage.
+	// Throws std::runtime_error, with the line and column for malformed input.
+	static Matrix<elementType> load(
+		const std::string& filename, unsigned int threads = 0, const allocator_type& allocator = allocator_type());
+
+	allocator_type get_allocator() const {
+		return elements.get_allocator();
+	}
+
+	unsigned long nRows() const {
 		return dim.first;
 	}
 
-	unsigned long nCols() {
+	unsigned long nCols() const {
 		return dim.second;
 	}
 
+	// As an operand a Matrix is either the destination, read only at the position being written, or owns separate
+	// elements, so it never needs a temporary.
+	bool readsWithin(const void*, const void*) const {
+		return false;
+	}
+
 private:
-	std::vector<elementType> elements;
+	template<class Expression>
+	bool readsElements(const MatrixExpression<Expression>& expression) const {
+		return !elements.empty() && expression.readsWithin(elements.data(), elements.data() + elements.size());
+	}
+
+	template<class Expression, class Update>
+	void assign(const Expression& expression, Update update) {
+		// Update each element from the expression row by row, the inner loop over contiguous elements being the one
+		// the compiler vectorizes.
+		for (unsigned long row = 0; row < dim.first; ++row) {
+			elementType* rowElements = elements.data() + static_cast<size_t>(row) * dim.second;
+			for (unsigned long col = 0; col < dim.second; ++col) {
+				update(rowElements[col], expression(row, col));
+			}
+		}
+	}
+
+	void requireDimensions(unsigned long rows, unsigned long cols) const {
+		if (rows != dim.first || cols != dim.second) {
+			throw std::runtime_error("Cannot update a " + std::to_string(dim.first) + "x" + std::to_string(dim.second) +
+				" matrix element-wise from a " + std::to_string(rows) + "x" + std::to_string(cols) + " matrix.");
+		}
+	}
+
 	std::pair<unsigned long, unsigned long> dim;
+	MatrixStorage<elementType> elements;
 };
 
 template<class elementType>
-Matrix<elementType> Matrix<elementType>::load(const std::string& filename) {
+Matrix<elementType> Matrix<elementType, matrixDynamicExtent, matrixDynamicExtent>::load(
+	const std::string& filename, unsigned int threads, const allocator_type& allocator) {
 	unsigned long nRows, nCols;
-	std::ifstream matrixFile(filename);
-
-	matrixFile >> nRows >> nCols;
-
-	std::vector<elementType> data(nRows*nCols);
-
-	for (unsigned long i = 0; i < data.size(); i++) {
-		matrixFile >> data[i];
-	}
+	MatrixStorage<elementType> data = loadMatrixText<elementType>(filename, threads, nRows, nCols, allocator);
 
-	return Matrix<elementType>(nRows, nCols, data);
+	return Matrix<elementType>(nRows, nCols, std::move(data));
 }
 
 template<class elementType>
-std::ostream& operator<<(std::ostream& os, Matrix<elementType> matrix) {
+std::ostream& operator<<(std::ostream& os, const Matrix<elementType>& matrix) {
 	for (unsigned long row = 0; row < matrix.nRows(); ++row) {
 		os << "[";
 		for (unsigned long col = 0; col < matrix.nCols(); ++col) {
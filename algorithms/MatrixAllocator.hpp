@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Matrix elements start on a 64-byte boundary, a cache line and a whole AVX-512 register, so rows of a matrix whose
+// row length is a multiple of the vector width never straddle cache lines.
+const size_t matrixAlignment = 64;
+
+// Allocator for Matrix storage drawing 64-byte aligned blocks from a std::pmr::memory_resource, by default the global
+// new and delete. A pool or arena is plugged in by constructing matrices with MatrixAllocator<T>(&resource), such as
+// a std::pmr::unsynchronized_pool_resource reused by many short-lived matrices on one thread, or a
+// synchronized_pool_resource shared between threads. The resource must outlive every matrix allocated from it.
+//
+// Elements are default-initialized, so storage that is about to be overwritten is not zeroed first. Copies of a
+// matrix allocate from the default resource, so a copy may safely outlive the source's arena.
+template<class elementType>
+class MatrixAllocator {
+public:
+	typedef elementType value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	MatrixAllocator() noexcept :
+		memoryResource(std::pmr::new_delete_resource()) {}
+
+	explicit MatrixAllocator(std::pmr::memory_resource* resource) noexcept :
+		memoryResource(resource) {}
+
+	template<class otherElementType>
+	MatrixAllocator(const MatrixAllocator<otherElementType>& other) noexcept :
+		memoryResource(other.resource()) {}
+
+	elementType* allocate(size_t count) {
+		if (count > (static_cast<size_t>(-1) - matrixAlignment) / sizeof(elementType)) {
+			throw std::bad_array_new_length();
+		}
+		return static_cast<elementType*>(memoryResource->allocate(blockSize(count), matrixAlignment));
+	}
+
+	void deallocate(elementType* elements, size_t count) noexcept {
+		memoryResource->deallocate(elements, blockSize(count), matrixAlignment);
+	}
+
+	template<class U>
+	void construct(U* element) noexcept(std::is_nothrow_default_constructible<U>::value) {
+		::new(static_cast<void*>(element)) U;
+	}
+
+	template<class U, class... Arguments>
+	void construct(U* element, Arguments&&... arguments) {
+		::new(static_cast<void*>(element)) U(std::forward<Arguments>(arguments)...);
+	}
+
+	MatrixAllocator select_on_container_copy_construction() const {
+		return MatrixAllocator();
+	}
+
+	std::pmr::memory_resource* resource() const noexcept {
+		return memoryResource;
+	}
+
+private:
+	static size_t blockSize(size_t count) {
+		// Whole cache lines, as pool resources align small blocks only to their size whatever alignment is requested.
+		return (count * sizeof(elementType) + matrixAlignment - 1) / matrixAlignment * matrixAlignment;
+	}
+
+	std::pmr::memory_resource* memoryResource;
+};
+
+template<class T, class U>
+bool operator==(const MatrixAllocator<T>& left, const MatrixAllocator<U>& right) noexcept {
+	return *left.resource() == *right.resource();
+}
+
+template<class T, class U>
+bool operator!=(const MatrixAllocator<T>& left, const MatrixAllocator<U>& right) noexcept {
+	return !(left == right);
+}
+
+// Element storage of a Matrix.
+template<class elementType>
+using MatrixStorage = std::vector<elementType, MatrixAllocator<elementType>>;
@@ -0,0 +1,141 @@
+#include "MatrixBinary.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const char matrixFileMagic[8] = { 'M', 'A', 'T', 'R', 'I', 'X', '\0', '\0' };
+static const uint32_t nativeByteOrder = 0x01020304;
+
+static_assert(sizeof(MatrixFileHeader) == 64, "MatrixFileHeader must be 64 bytes.");
+
+
+bool parseMatrixElementType(const string& name, MatrixElementType& elementType) {
+	for (MatrixElementType candidate : {
+		MatrixElementType::float32, MatrixElementType::float64, MatrixElementType::int32, MatrixElementType::int64 }) {
+		if (name == matrixElementTypeName(candidate)) {
+			elementType = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+const char* matrixElementTypeName(MatrixElementType elementType) {
+	switch (elementType) {
+	case MatrixElementType::float32:
+		return "float32";
+	case MatrixElementType::float64:
+		return "float64";
+	case MatrixElementType::int32:
+		return "int32";
+	case MatrixElementType::int64:
+		return "int64";
+	default:
+		return "unknown";
+	}
+}
+
+
+static uint32_t elementSize(MatrixElementType elementType) {
+	return elementType == MatrixElementType::float32 || elementType == MatrixElementType::int32 ? 4 : 8;
+}
+
+
+MatrixFileHeader makeMatrixFileHeader(MatrixElementType elementType, uint64_t nRows, uint64_t nCols) {
+	MatrixFileHeader header = MatrixFileHeader();
+	memcpy(header.magic, matrixFileMagic, sizeof(matrixFileMagic));
+	header.version = matrixFileVersion;
+	header.byteOrder = nativeByteOrder;
+	header.elementType = static_cast<uint32_t>(elementType);
+	header.elementSize = elementSize(elementType);
+	header.alignment = matrixFileAlignment;
+	header.nRows = nRows;
+	header.nCols = nCols;
+	header.dataOffset = (sizeof(MatrixFileHeader) + matrixFileAlignment - 1) / matrixFileAlignment * matrixFileAlignment;
+
+	return header;
+}
+
+
+size_t matrixFileSize(const MatrixFileHeader& header) {
+	uint64_t limit = numeric_limits<size_t>::max();
+	if (header.dataOffset > limit ||
+		(header.nCols != 0 && header.nRows > (limit - header.dataOffset) / header.elementSize / header.nCols)) {
+		throw runtime_error("A " + to_string(header.nRows) + "x" + to_string(header.nCols) + " matrix is too large.");
+	}
+	return static_cast<size_t>(header.dataOffset + header.nRows * header.nCols * header.elementSize);
+}
+
+
+bool isMatrixBinaryFile(const string& filename) {
+	char magic[sizeof(matrixFileMagic)];
+	ifstream file(filename, ios::binary);
+	return file.read(magic, sizeof(magic)) && memcmp(magic, matrixFileMagic, sizeof(magic)) == 0;
+}
+
+
+static void checkMatrixFileHeader(const MatrixFileHeader& header, uint64_t fileSize, const string& filename) {
+	if (memcmp(header.magic, matrixFileMagic, sizeof(matrixFileMagic)) != 0) {
+		throw runtime_error(filename + " is not a binary matrix file.");
+	}
+	if (header.version != matrixFileVersion) {
+		throw runtime_error(filename + " has unsupported version " + to_string(header.version) + ".");
+	}
+	if (header.byteOrder != nativeByteOrder) {
+		throw runtime_error(filename + " was written with the other byte order.");
+	}
+
+	MatrixElementType elementType = static_cast<MatrixElementType>(header.elementType);
+	if (string(matrixElementTypeName(elementType)) == "unknown" || header.elementSize != elementSize(elementType) ||
+		header.dataOffset < sizeof(MatrixFileHeader) || header.alignment == 0 || header.dataOffset % header.alignment != 0) {
+		throw runtime_error(filename + " has a malformed header.");
+	}
+	if (header.nRows > numeric_limits<unsigned long>::max() || header.nCols > numeric_limits<unsigned long>::max()) {
+		throw runtime_error(filename + " has more rows or columns than are supported.");
+	}
+	// Divide rather than multiply, so a huge nRows * nCols cannot wrap around to a size that fits.
+	if (fileSize < header.dataOffset ||
+		(header.nCols != 0 && header.nRows > (fileSize - header.dataOffset) / header.elementSize / header.nCols)) {
+		throw runtime_error(filename + " is shorter than its header says.");
+	}
+}
+
+
+const MatrixFileHeader& readMatrixFileHeader(const MappedFile& file, const string& filename) {
+	if (file.size() < sizeof(MatrixFileHeader)) {
+		throw runtime_error(filename + " is not a binary matrix file.");
+	}
+
+	const MatrixFileHeader& header = *reinterpret_cast<const MatrixFileHeader*>(file.data());
+	checkMatrixFileHeader(header, file.size(), filename);
+	return header;
+}
+
+
+MatrixFileHeader readMatrixFileHeader(const PositionalFile& file) {
+	MatrixFileHeader header;
+	if (file.size() < sizeof(MatrixFileHeader)) {
+		throw runtime_error(file.filename() + " is not a binary matrix file.");
+	}
+
+	file.read(0, &header, sizeof(header));
+	checkMatrixFileHeader(header, file.size(), file.filename());
+	return header;
+}
+
+
+void checkOutputFile(const string& outputFilename, const vector<string>& inputFilenames) {
+	for (const string& inputFilename : inputFilenames) {
+		if (isSameFile(outputFilename, inputFilename)) {
+			throw runtime_error("The output " + outputFilename + " is the same file as the input " + inputFilename + ".");
+		}
+	}
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "PositionalFile.hpp"
+#include "MatrixText.hpp"
+#include "MatrixView.hpp"
+
+// Binary matrix file: a 64-byte MatrixFileHeader, then nRows*nCols elements in row-major order starting at
+// dataOffset, which is a multiple of alignment. Multi-byte values are in the byte order of the writer, recorded
+// in byteOrder so a file from a machine of the other order is rejected rather than misread.
+enum class MatrixElementType : uint32_t { float32 = 1, float64 = 2, int32 = 3, int64 = 4 };
+
+bool parseMatrixElementType(const std::string& name, MatrixElementType& elementType);
+const char* matrixElementTypeName(MatrixElementType elementType);
+
+template<class elementType> struct MatrixElementTypeOf;
+template<> struct MatrixElementTypeOf<float> { static const MatrixElementType value = MatrixElementType::float32; };
+template<> struct MatrixElementTypeOf<double> { static const MatrixElementType value = MatrixElementType::float64; };
+template<> struct MatrixElementTypeOf<int32_t> { static const MatrixElementType value = MatrixElementType::int32; };
+template<> struct MatrixElementTypeOf<int64_t> { static const MatrixElementType value = MatrixElementType::int64; };
+
+struct MatrixFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t elementType;
+	uint32_t elementSize;
+	uint64_t alignment;
+	uint64_t nRows;
+	uint64_t nCols;
+	uint64_t dataOffset;
+	uint64_t reserved;
+};
+
+const uint32_t matrixFileVersion = 1;
+const uint64_t matrixFileAlignment = 64;
+
+MatrixFileHeader makeMatrixFileHeader(MatrixElementType elementType, uint64_t nRows, uint64_t nCols);
+size_t matrixFileSize(const MatrixFileHeader& header);
+bool isMatrixBinaryFile(const std::string& filename);
+// Check the header at the start of a mapped file and that the file holds all the data. Throws std::runtime_error.
+const MatrixFileHeader& readMatrixFileHeader(const MappedFile& file, const std::string& filename);
+MatrixFileHeader readMatrixFileHeader(const PositionalFile& file);
+// Throw std::runtime_error if outputFilename names the same file as one of inputFilenames, through any path, as
+// creating the output would destroy that input before it is read.
+void checkOutputFile(const std::string& outputFilename, const std::vector<std::string>& inputFilenames);
+
+// Binary matrix file mapped read-only, whose elements are read in place through view(). Opening costs one mapping
+// whatever the size, and the pages are shared with every other process mapping the same file.
+template<class elementType>
+class MappedMatrix {
+public:
+	explicit MappedMatrix(const std::string& filename) :
+		file(filename, MappedFile::Mode::read) {
+		const MatrixFileHeader& header = readMatrixFileHeader(file, filename);
+		if (header.elementType != static_cast<uint32_t>(MatrixElementTypeOf<elementType>::value)) {
+			throw std::runtime_error(filename + " holds " +
+				matrixElementTypeName(static_cast<MatrixElementType>(header.elementType)) + " elements, not " +
+				matrixElementTypeName(MatrixElementTypeOf<elementType>::value) + ".");
+		}
+
+		matrixView = MatrixView<elementType>(
+			reinterpret_cast<const elementType*>(file.data() + header.dataOffset),
+			static_cast<unsigned long>(header.nRows), static_cast<unsigned long>(header.nCols));
+	}
+
+	const MatrixView<elementType>& view() const {
+		return matrixView;
+	}
+
+	elementType operator()(unsigned long row, unsigned long col) const {
+		return matrixView(row, col);
+	}
+
+	unsigned long nRows() const {
+		return matrixView.nRows();
+	}
+
+	unsigned long nCols() const {
+		return matrixView.nCols();
+	}
+
+private:
+	MappedFile file;
+	MatrixView<elementType> matrixView;
+};
+
+
+template<class elementType>
+void saveMatrixBinary(const MatrixView<elementType>& matrix, const std::string& filename) {
+	MatrixFileHeader header = makeMatrixFileHeader(MatrixElementTypeOf<elementType>::value, matrix.nRows(), matrix.nCols());
+	MappedFile file(filename, MappedFile::Mode::create, matrixFileSize(header));
+	memcpy(file.data(), &header, sizeof(header));
+	if (header.nRows * header.nCols == 0) {
+		return;
+	}
+
+	elementType* elements = reinterpret_cast<elementType*>(file.data() + header.dataOffset);
+	if (matrix.isContiguous()) {
+		memcpy(elements, matrix.data(), header.nRows * header.nCols * sizeof(elementType));
+		return;
+	}
+
+	// A strided view, such as a block or transpose, is gathered row by row.
+	for (unsigned long row = 0; row < matrix.nRows(); row++) {
+		for (unsigned long col = 0; col < matrix.nCols(); col++) {
+			*elements++ = matrix(row, col);
+		}
+	}
+}
+
+
+template<class elementType>
+void convertMatrixTextToBinary(const std::string& textFilename, const std::string& binaryFilename, unsigned int threads = 0) {
+	// Parse the text straight into the mapped output file, so no copy of the matrix is held in memory. If the text
+	// turns out to be malformed, the half-written output is removed.
+
+	MappedFile file;
+	bool created = false;
+	try {
+		parseMatrixText<elementType>(textFilename, threads, [&](unsigned long nRows, unsigned long nCols) {
+			MatrixFileHeader header = makeMatrixFileHeader(MatrixElementTypeOf<elementType>::value, nRows, nCols);
+			file = MappedFile(binaryFilename, MappedFile::Mode::create, matrixFileSize(header));
+			created = true;
+			memcpy(file.data(), &header, sizeof(header));
+			return reinterpret_cast<elementType*>(file.data() + header.dataOffset);
+		});
+	}
+	catch (...) {
+		if (created) {
+			file.close();
+			std::remove(binaryFilename.c_str());
+		}
+		throw;
+	}
+}
+
+
+template<class elementType>
+void writeMatrixText(const MatrixView<elementType>& matrix, std::ostream& os) {
+	// Write "nRows nCols" and then one row per line, each element in the shortest form that reads back the same.
+
+	const size_t bufferSize = 1 << 20;
+	std::vector<char> buffer(bufferSize);
+	size_t used = 0;
+	auto flush = [&]() {
+		os.write(buffer.data(), used);
+		used = 0;
+	};
+
+	os << matrix.nRows() << " " << matrix.nCols() << "\n";
+	for (unsigned long row = 0; row < matrix.nRows(); row++) {
+		for (unsigned long col = 0; col < matrix.nCols(); col++) {
+			if (bufferSize - used < 64) {
+				flush();
+			}
+			char* next = std::to_chars(buffer.data() + used, buffer.data() + bufferSize - 1, matrix(row, col)).ptr;
+			*next++ = col + 1 == matrix.nCols() ? '\n' : ' ';
+			used = next - buffer.data();
+		}
+	}
+	flush();
+}
+
+
+template<class elementType>
+void convertMatrixBinaryToText(const std::string& binaryFilename, const std::string& textFilename) {
+	MappedMatrix<elementType> matrix(binaryFilename);
+	std::ofstream textFile(textFilename, std::ios::binary);
+	if (!textFile) {
+		throw std::runtime_error("Cannot open " + textFilename + ".");
+	}
+
+	writeMatrixText(matrix.view(), textFile);
+	if (!textFile) {
+		throw std::runtime_error("Cannot write " + textFilename + ".");
+	}
+}
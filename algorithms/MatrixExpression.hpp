@@ -0,0 +1,283 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+
+// Element-wise Matrix arithmetic is lazy: operators return small expression objects that record the operands, and
+// the whole expression is evaluated element by element in one loop when it is assigned to a Matrix or reduced. No
+// temporary matrices are allocated however many operations are chained, and the loop over each row is free of calls
+// so the compiler can vectorize it.
+//
+// Each element of the result depends only on the same element of its Matrix operands, but a view operand, such as a
+// transpose or block, may read elements of the destination at other positions. Assigning to a Matrix therefore checks
+// readsWithin() for the destination's elements and evaluates into a temporary first when a view overlaps them.
+// Expressions refer to Matrix operands rather than copying them, so an expression must not outlive its operands;
+// evaluate it in the statement that builds it rather than keeping it in an auto variable.
+
+// Extent of a Matrix whose dimensions are chosen at run time. Matrix<T> is the dynamic matrix and Matrix<T, rows, cols>
+// the fixed-size one.
+const size_t matrixDynamicExtent = static_cast<size_t>(-1);
+
+template<class elementType, size_t rows = matrixDynamicExtent, size_t cols = matrixDynamicExtent> class Matrix;
+
+// Base of every expression, Derived being the expression type itself. Derived provides value_type, nRows(), nCols()
+// and operator()(row, col).
+template<class Derived>
+class MatrixExpression {
+public:
+	const Derived& derived() const {
+		return static_cast<const Derived&>(*this);
+	}
+
+	unsigned long nRows() const {
+		return derived().nRows();
+	}
+
+	unsigned long nCols() const {
+		return derived().nCols();
+	}
+
+	auto operator()(unsigned long row, unsigned long col) const {
+		return derived()(row, col);
+	}
+
+	// True if a view in the expression reads any element stored in [first, last). Matrix operands are not counted: one
+	// is either the destination itself, read only at the position being written, or owns separate elements.
+	bool readsWithin(const void* first, const void* last) const {
+		return derived().readsWithin(first, last);
+	}
+};
+
+// Matrices are held by reference inside expressions, everything else, including views and nested expressions, by value.
+template<class Expression>
+struct MatrixOperandStorage {
+	typedef const Expression type;
+};
+
+template<class elementType, size_t rows, size_t cols>
+struct MatrixOperandStorage<Matrix<elementType, rows, cols>> {
+	typedef const Matrix<elementType, rows, cols>& type;
+};
+
+
+template<class Operand, class Function>
+class MatrixUnaryExpression : public MatrixExpression<MatrixUnaryExpression<Operand, Function>> {
+public:
+	typedef typename Operand::value_type value_type;
+
+	MatrixUnaryExpression(const Operand& expressionOperand, Function expressionFunction) :
+		operand(expressionOperand),
+		function(expressionFunction) {}
+
+	unsigned long nRows() const {
+		return operand.nRows();
+	}
+
+	unsigned long nCols() const {
+		return operand.nCols();
+	}
+
+	value_type operator()(unsigned long row, unsigned long col) const {
+		return static_cast<value_type>(function(operand(row, col)));
+	}
+
+	bool readsWithin(const void* first, const void* last) const {
+		return operand.readsWithin(first, last);
+	}
+
+private:
+	typename MatrixOperandStorage<Operand>::type operand;
+	Function function;
+};
+
+
+template<class Left, class Right, class Function>
+class MatrixBinaryExpression : public MatrixExpression<MatrixBinaryExpression<Left, Right, Function>> {
+public:
+	typedef typename Left::value_type value_type;
+
+	MatrixBinaryExpression(const Left& leftOperand, const Right& rightOperand, Function expressionFunction) :
+		left(leftOperand),
+		right(rightOperand),
+		function(expressionFunction) {
+		if (left.nRows() != right.nRows() || left.nCols() != right.nCols()) {
+			throw std::runtime_error("Cannot combine a " + std::to_string(left.nRows()) + "x" +
+				std::to_string(left.nCols()) + " matrix element-wise with a " + std::to_string(right.nRows()) + "x" +
+				std::to_string(right.nCols()) + " matrix.");
+		}
+	}
+
+	unsigned long nRows() const {
+		return left.nRows();
+	}
+
+	unsigned long nCols() const {
+		return left.nCols();
+	}
+
+	value_type operator()(unsigned long row, unsigned long col) const {
+		return static_cast<value_type>(function(left(row, col), right(row, col)));
+	}
+
+	bool readsWithin(const void* first, const void* last) const {
+		return left.readsWithin(first, last) || right.readsWithin(first, last);
+	}
+
+private:
+	typename MatrixOperandStorage<Left>::type left;
+	typename MatrixOperandStorage<Right>::type right;
+	Function function;
+};
+
+
+// Apply function to every element.
+template<class Operand, class Function>
+MatrixUnaryExpression<Operand, Function> mapElements(const MatrixExpression<Operand>& operand, Function function) {
+	return MatrixUnaryExpression<Operand, Function>(operand.derived(), function);
+}
+
+// Combine corresponding elements with function.
+template<class Left, class Right, class Function>
+MatrixBinaryExpression<Left, Right, Function> zipElements(
+	const MatrixExpression<Left>& left, const MatrixExpression<Right>& right, Function function) {
+	return MatrixBinaryExpression<Left, Right, Function>(left.derived(), right.derived(), function);
+}
+
+
+template<class Left, class Right>
+auto operator+(const MatrixExpression<Left>& left, const MatrixExpression<Right>& right) {
+	return zipElements(left, right, [](auto x, auto y) { return x + y; });
+}
+
+template<class Left, class Right>
+auto operator-(const MatrixExpression<Left>& left, const MatrixExpression<Right>& right) {
+	return zipElements(left, right, [](auto x, auto y) { return x - y; });
+}
+
+// Element-wise products; a * b between matrices is left unspelled as it would read as the matrix product.
+template<class Left, class Right>
+auto elementwiseProduct(const MatrixExpression<Left>& left, const MatrixExpression<Right>& right) {
+	return zipElements(left, right, [](auto x, auto y) { return x * y; });
+}
+
+template<class Left, class Right>
+auto elementwiseQuotient(const MatrixExpression<Left>& left, const MatrixExpression<Right>& right) {
+	return zipElements(left, right, [](auto x, auto y) { return x / y; });
+}
+
+template<class Operand>
+auto operator-(const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [](auto x) { return -x; });
+}
+
+// Scalar arithmetic applies to every element. The scalar takes the element type, so a * 2 works for Matrix<double>.
+template<class Operand>
+auto operator+(const MatrixExpression<Operand>& operand, typename Operand::value_type scalar) {
+	return mapElements(operand, [scalar](auto x) { return x + scalar; });
+}
+
+template<class Operand>
+auto operator+(typename Operand::value_type scalar, const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [scalar](auto x) { return scalar + x; });
+}
+
+template<class Operand>
+auto operator-(const MatrixExpression<Operand>& operand, typename Operand::value_type scalar) {
+	return mapElements(operand, [scalar](auto x) { return x - scalar; });
+}
+
+template<class Operand>
+auto operator-(typename Operand::value_type scalar, const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [scalar](auto x) { return scalar - x; });
+}
+
+template<class Operand>
+auto operator*(const MatrixExpression<Operand>& operand, typename Operand::value_type scalar) {
+	return mapElements(operand, [scalar](auto x) { return x * scalar; });
+}
+
+template<class Operand>
+auto operator*(typename Operand::value_type scalar, const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [scalar](auto x) { return scalar * x; });
+}
+
+template<class Operand>
+auto operator/(const MatrixExpression<Operand>& operand, typename Operand::value_type scalar) {
+	return mapElements(operand, [scalar](auto x) { return x / scalar; });
+}
+
+template<class Operand>
+auto abs(const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [](auto x) { return std::abs(x); });
+}
+
+template<class Operand>
+auto sqrt(const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [](auto x) { return std::sqrt(x); });
+}
+
+template<class Operand>
+auto exp(const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [](auto x) { return std::exp(x); });
+}
+
+template<class Operand>
+auto log(const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [](auto x) { return std::log(x); });
+}
+
+template<class Operand>
+auto square(const MatrixExpression<Operand>& operand) {
+	return mapElements(operand, [](auto x) { return x * x; });
+}
+
+
+template<class Expression>
+typename Expression::value_type sum(const MatrixExpression<Expression>& expression) {
+	// Sum the elements in one pass. Eight independent partial sums per row let the compiler keep them in one vector
+	// register, which it may not do for a single running sum without reassociating floating point additions.
+
+	typedef typename Expression::value_type value_type;
+	const unsigned long lanes = 8;
+	const Expression& e = expression.derived();
+
+	value_type partialSums[lanes] = {};
+	unsigned long nCols = e.nCols();
+	for (unsigned long row = 0; row < e.nRows(); row++) {
+		unsigned long col = 0;
+		for (; col + lanes <= nCols; col += lanes) {
+			for (unsigned long lane = 0; lane < lanes; lane++) {
+				partialSums[lane] += e(row, col + lane);
+			}
+		}
+		for (; col < nCols; col++) {
+			partialSums[col % lanes] += e(row, col);
+		}
+	}
+
+	value_type total = 0;
+	for (unsigned long lane = 0; lane < lanes; lane++) {
+		total += partialSums[lane];
+	}
+
+	return total;
+}
+
+// Reductions of expressions are fused into the same single pass as sum.
+template<class Left, class Right>
+typename Left::value_type dot(const MatrixExpression<Left>& left, const MatrixExpression<Right>& right) {
+	return sum(elementwiseProduct(left, right));
+}
+
+template<class Expression>
+typename Expression::value_type squaredNorm(const MatrixExpression<Expression>& expression) {
+	return sum(square(expression));
+}
+
+// Frobenius norm.
+template<class Expression>
+typename Expression::value_type frobeniusNorm(const MatrixExpression<Expression>& expression) {
+	return std::sqrt(squaredNorm(expression));
+}
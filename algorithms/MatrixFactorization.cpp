@@ -0,0 +1,385 @@
+#include "MatrixFactorization.hpp"
+#include "MatrixMultiply.hpp"
+#include "TaskGraph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// Tiles of the factorizations are factorizationBlock square, large enough for gemm to run near its peak on a tile
+// update and small enough to leave many tiles to share out over threads. Triangular solves handle triangularBlock
+// rows at a time, the rest of each step going to gemm.
+static const size_t factorizationBlock = 192;
+static const size_t triangularBlock = 64;
+
+// A panel narrower than this is factorized column by column rather than split in two.
+static const size_t panelBlock = 16;
+
+// Tasks run on the graph's threads, so the gemm inside each uses one.
+static const unsigned int taskThreads = 1;
+
+static const TaskGraph::TaskId noTask = static_cast<TaskGraph::TaskId>(-1);
+
+
+static void requireSquare(unsigned long rows, unsigned long cols) {
+	if (rows != cols) {
+		throw runtime_error("Cannot factorize a " + to_string(rows) + "x" + to_string(cols) + " matrix; it must be square.");
+	}
+}
+
+
+template<class elementType>
+static void solveTriangular(
+	bool lower, Transpose transpose, bool unitDiagonal, const elementType* a, size_t lda, size_t n,
+	elementType* b, size_t ldb, size_t k, unsigned int threads) {
+	// B := op(A)^-1 B for the n x n triangular op(A), lower or upper, and the n x k B. Each block of rows is first
+	// updated with the rows already solved by gemm, then solved within the block's diagonal triangle.
+
+	auto op = [&](size_t row, size_t col) {
+		return transpose == Transpose::yes ? a[col * lda + row] : a[row * lda + col];
+	};
+	auto opBlock = [&](size_t row, size_t col) {
+		return transpose == Transpose::yes ? a + col * lda + row : a + row * lda + col;
+	};
+	auto solveRow = [&](size_t row, size_t first, size_t last) {
+		elementType* bRow = b + row * ldb;
+		for (size_t p = first; p < last; p++) {
+			elementType factor = op(row, p);
+			if (factor != 0) {
+				const elementType* bSolved = b + p * ldb;
+				for (size_t c = 0; c < k; c++) {
+					bRow[c] -= factor * bSolved[c];
+				}
+			}
+		}
+		if (!unitDiagonal) {
+			elementType scale = elementType(1) / op(row, row);
+			for (size_t c = 0; c < k; c++) {
+				bRow[c] *= scale;
+			}
+		}
+	};
+
+	if (lower) {
+		for (size_t first = 0; first < n; first += triangularBlock) {
+			size_t last = min(n, first + triangularBlock);
+			if (first > 0) {
+				gemm(transpose, Transpose::no, last - first, k, first,
+					elementType(-1), opBlock(first, 0), lda, b, ldb, elementType(1), b + first * ldb, ldb, threads);
+			}
+			for (size_t row = first; row < last; row++) {
+				solveRow(row, first, row);
+			}
+		}
+	}
+	else {
+		for (size_t last = n; last > 0;) {
+			size_t first = last > triangularBlock ? last - triangularBlock : 0;
+			if (last < n) {
+				gemm(transpose, Transpose::no, last - first, k, n - last,
+					elementType(-1), opBlock(first, last), lda, b + last * ldb, ldb, elementType(1), b + first * ldb, ldb, threads);
+			}
+			for (size_t row = last; row-- > first;) {
+				solveRow(row, row + 1, last);
+			}
+			last = first;
+		}
+	}
+}
+
+template<class elementType>
+static void swapRows(elementType* a, size_t lda, size_t row, size_t other, size_t firstCol, size_t lastCol) {
+	if (row != other) {
+		swap_ranges(a + row * lda + firstCol, a + row * lda + lastCol, a + other * lda + firstCol);
+	}
+}
+
+
+template<class elementType>
+static void factorizeLuPanel(elementType* a, size_t lda, size_t m, size_t n, size_t* pivots) {
+	// Factorize the m x n panel at a, m >= n, with partial pivoting, swapping whole rows of the panel. pivots[i] is
+	// the panel row swapped with row i. Wide panels are split in two recursively, so most of the work is gemm.
+
+	if (n <= panelBlock) {
+		for (size_t col = 0; col < n; col++) {
+			size_t pivot = col;
+			for (size_t row = col + 1; row < m; row++) {
+				if (abs(a[row * lda + col]) > abs(a[pivot * lda + col])) {
+					pivot = row;
+				}
+			}
+			if (a[pivot * lda + col] == 0) {
+				throw runtime_error("Cannot factorize a singular matrix.");
+			}
+			pivots[col] = pivot;
+			swapRows(a, lda, col, pivot, 0, n);
+
+			const elementType* pivotRow = a + col * lda;
+			elementType scale = elementType(1) / pivotRow[col];
+			for (size_t row = col + 1; row < m; row++) {
+				elementType* aRow = a + row * lda;
+				aRow[col] *= scale;
+				for (size_t c = col + 1; c < n; c++) {
+					aRow[c] -= aRow[col] * pivotRow[c];
+				}
+			}
+		}
+		return;
+	}
+
+	size_t left = n / 2;
+	size_t right = n - left;
+	factorizeLuPanel(a, lda, m, left, pivots);
+	for (size_t row = 0; row < left; row++) {
+		swapRows(a, lda, row, pivots[row], left, n);
+	}
+	solveTriangular(true, Transpose::no, true, a, lda, left, a + left, lda, right, taskThreads);
+	gemm(Transpose::no, Transpose::no, m - left, right, left,
+		elementType(-1), a + left * lda, lda, a + left, lda, elementType(1), a + left * lda + left, lda, taskThreads);
+
+	factorizeLuPanel(a + left * lda + left, lda, m - left, right, pivots + left);
+	for (size_t row = left; row < n; row++) {
+		pivots[row] += left;
+		swapRows(a, lda, row, pivots[row], 0, left);
+	}
+}
+
+template<class elementType>
+LuFactorization<elementType>::LuFactorization(const MatrixView<elementType>& a, unsigned int threads) :
+	lu(a),
+	rowPivots(a.nRows()) {
+	// For each panel k of columns: factorize the panel; then for each block column j to its right, apply the panel's
+	// row swaps and solve for the U tile of row k, and update each tile below it. The row swaps of later panels are
+	// applied to the columns of L at the end.
+
+	requireSquare(a.nRows(), a.nCols());
+
+	const size_t n = lu.nRows();
+	const size_t blocks = (n + factorizationBlock - 1) / factorizationBlock;
+	elementType* elements = lu.data();
+	size_t* pivots = rowPivots.data();
+	auto tile = [&](size_t row, size_t col) {
+		return elements + row * factorizationBlock * n + col * factorizationBlock;
+	};
+	auto blockEnd = [&](size_t block) {
+		return min(n, (block + 1) * factorizationBlock);
+	};
+
+	// The task last writing each tile, which the next task using the tile depends on.
+	TaskGraph graph;
+	vector<TaskGraph::TaskId> writers(blocks * blocks, noTask);
+	auto columnWriters = [&](size_t firstRow, size_t col) {
+		vector<TaskGraph::TaskId> dependencies;
+		for (size_t row = firstRow; row < blocks; row++) {
+			if (writers[row * blocks + col] != noTask) {
+				dependencies.push_back(writers[row * blocks + col]);
+			}
+		}
+		return dependencies;
+	};
+
+	for (size_t k = 0; k < blocks; k++) {
+		size_t first = k * factorizationBlock;
+		size_t last = blockEnd(k);
+
+		// The panel is the critical path, and the tiles of the next panel are close behind.
+		TaskGraph::TaskId panel = graph.add([=]() {
+			factorizeLuPanel(tile(k, k), n, n - first, last - first, pivots + first);
+			for (size_t row = first; row < last; row++) {
+				pivots[row] += first;
+			}
+		}, columnWriters(k, k), 2);
+		for (size_t row = k; row < blocks; row++) {
+			writers[row * blocks + k] = panel;
+		}
+
+		for (size_t j = k + 1; j < blocks; j++) {
+			size_t firstCol = j * factorizationBlock;
+			size_t lastCol = blockEnd(j);
+			int priority = j == k + 1 ? 1 : 0;
+
+			vector<TaskGraph::TaskId> dependencies = columnWriters(k, j);
+			dependencies.push_back(panel);
+			TaskGraph::TaskId solve = graph.add([=]() {
+				for (size_t row = first; row < last; row++) {
+					swapRows(elements, n, row, pivots[row], firstCol, lastCol);
+				}
+				solveTriangular(true, Transpose::no, true, tile(k, k), n, last - first,
+					tile(k, j), n, lastCol - firstCol, taskThreads);
+			}, dependencies, priority);
+			for (size_t row = k; row < blocks; row++) {
+				writers[row * blocks + j] = solve;
+			}
+
+			for (size_t i = k + 1; i < blocks; i++) {
+				size_t firstRow = i * factorizationBlock;
+				writers[i * blocks + j] = graph.add([=]() {
+					gemm(Transpose::no, Transpose::no, blockEnd(i) - firstRow, lastCol - firstCol, last - first,
+						elementType(-1), tile(i, k), n, tile(k, j), n, elementType(1), tile(i, j), n, taskThreads);
+				}, { solve }, priority);
+			}
+		}
+	}
+
+	graph.run(threads);
+
+	parallelFor(blocks, threads, [&](size_t firstBlock, size_t lastBlock) {
+		for (size_t k = firstBlock; k < lastBlock; k++) {
+			for (size_t row = blockEnd(k); row < n; row++) {
+				swapRows(elements, n, row, pivots[row], k * factorizationBlock, blockEnd(k));
+			}
+		}
+	});
+}
+
+template<class elementType>
+Matrix<elementType> LuFactorization<elementType>::solve(const MatrixView<elementType>& b, unsigned int threads) const {
+	if (b.nRows() != size()) {
+		throw runtime_error("Cannot solve a " + to_string(size()) + "x" + to_string(size()) + " system for a " +
+			to_string(b.nRows()) + "x" + to_string(b.nCols()) + " right-hand side.");
+	}
+
+	const size_t n = size();
+	const size_t k = b.nCols();
+	Matrix<elementType> x(b);
+	for (size_t row = 0; row < n; row++) {
+		swapRows(x.data(), k, row, rowPivots[row], 0, k);
+	}
+	solveTriangular(true, Transpose::no, true, lu.data(), n, n, x.data(), k, k, threads);
+	solveTriangular(false, Transpose::no, false, lu.data(), n, n, x.data(), k, k, threads);
+	return x;
+}
+
+
+template<class elementType>
+static void factorizeCholeskyTile(elementType* a, size_t lda, size_t n, size_t firstCol) {
+	// Replace the lower triangle of the n x n tile at a with its Cholesky factor. firstCol is the tile's first column
+	// in the whole matrix, for the error message.
+
+	for (size_t col = 0; col < n; col++) {
+		elementType* colRow = a + col * lda;
+		elementType diagonal = colRow[col];
+		for (size_t p = 0; p < col; p++) {
+			diagonal -= colRow[p] * colRow[p];
+		}
+		if (!(diagonal > 0)) {
+			throw runtime_error("Cannot factorize a matrix that is not positive definite (pivot " +
+				to_string(firstCol + col + 1) + ").");
+		}
+		colRow[col] = sqrt(diagonal);
+
+		elementType scale = elementType(1) / colRow[col];
+		for (size_t row = col + 1; row < n; row++) {
+			elementType* aRow = a + row * lda;
+			elementType sum = aRow[col];
+			for (size_t p = 0; p < col; p++) {
+				sum -= aRow[p] * colRow[p];
+			}
+			aRow[col] = sum * scale;
+		}
+	}
+}
+
+template<class elementType>
+static void solveCholeskyTile(const elementType* l, size_t ldl, size_t n, elementType* a, size_t lda, size_t m) {
+	// A := A L^-T for the n x n lower triangular L and the m x n A. Solved as A^T := L^-1 A^T on a transposed copy,
+	// which solveTriangular does mostly in gemm, rather than as m separate row solves.
+
+	vector<elementType> transposed(n * m);
+	for (size_t row = 0; row < m; row++) {
+		for (size_t col = 0; col < n; col++) {
+			transposed[col * m + row] = a[row * lda + col];
+		}
+	}
+	solveTriangular(true, Transpose::no, false, l, ldl, n, transposed.data(), m, m, taskThreads);
+	for (size_t row = 0; row < m; row++) {
+		for (size_t col = 0; col < n; col++) {
+			a[row * lda + col] = transposed[col * m + row];
+		}
+	}
+}
+
+template<class elementType>
+CholeskyFactorization<elementType>::CholeskyFactorization(const MatrixView<elementType>& a, unsigned int threads) :
+	l(a) {
+	// For each block column k: factorize the diagonal tile, solve for the tiles below it, and subtract their products
+	// from the tiles of the lower triangle to the right.
+
+	requireSquare(a.nRows(), a.nCols());
+
+	const size_t n = l.nRows();
+	const size_t blocks = (n + factorizationBlock - 1) / factorizationBlock;
+	elementType* elements = l.data();
+	auto tile = [&](size_t row, size_t col) {
+		return elements + row * factorizationBlock * n + col * factorizationBlock;
+	};
+	auto blockSize = [&](size_t block) {
+		return min(n, (block + 1) * factorizationBlock) - block * factorizationBlock;
+	};
+
+	TaskGraph graph;
+	vector<TaskGraph::TaskId> writers(blocks * blocks, noTask);
+	auto after = [&](initializer_list<TaskGraph::TaskId> tasks) {
+		vector<TaskGraph::TaskId> dependencies;
+		for (TaskGraph::TaskId task : tasks) {
+			if (task != noTask) {
+				dependencies.push_back(task);
+			}
+		}
+		return dependencies;
+	};
+
+	for (size_t k = 0; k < blocks; k++) {
+		TaskGraph::TaskId diagonal = graph.add([=]() {
+			factorizeCholeskyTile(tile(k, k), n, blockSize(k), k * factorizationBlock);
+		}, after({ writers[k * blocks + k] }), 2);
+		writers[k * blocks + k] = diagonal;
+
+		for (size_t i = k + 1; i < blocks; i++) {
+			writers[i * blocks + k] = graph.add([=]() {
+				solveCholeskyTile(tile(k, k), n, blockSize(k), tile(i, k), n, blockSize(i));
+			}, after({ diagonal, writers[i * blocks + k] }), 1);
+		}
+
+		for (size_t j = k + 1; j < blocks; j++) {
+			for (size_t i = j; i < blocks; i++) {
+				writers[i * blocks + j] = graph.add([=]() {
+					gemm(Transpose::no, Transpose::yes, blockSize(i), blockSize(j), blockSize(k),
+						elementType(-1), tile(i, k), n, tile(j, k), n, elementType(1), tile(i, j), n, taskThreads);
+				}, after({ writers[i * blocks + k], writers[j * blocks + k], writers[i * blocks + j] }), j == k + 1 ? 1 : 0);
+			}
+		}
+	}
+
+	graph.run(threads);
+
+	for (size_t row = 0; row < n; row++) {
+		fill(elements + row * n + row + 1, elements + (row + 1) * n, elementType(0));
+	}
+}
+
+template<class elementType>
+Matrix<elementType> CholeskyFactorization<elementType>::solve(const MatrixView<elementType>& b, unsigned int threads) const {
+	if (b.nRows() != size()) {
+		throw runtime_error("Cannot solve a " + to_string(size()) + "x" + to_string(size()) + " system for a " +
+			to_string(b.nRows()) + "x" + to_string(b.nCols()) + " right-hand side.");
+	}
+
+	const size_t n = size();
+	const size_t k = b.nCols();
+	Matrix<elementType> x(b);
+	solveTriangular(true, Transpose::no, false, l.data(), n, n, x.data(), k, k, threads);
+	solveTriangular(false, Transpose::yes, false, l.data(), n, n, x.data(), k, k, threads);
+	return x;
+}
+
+
+template class LuFactorization<double>;
+template class LuFactorization<float>;
+template class CholeskyFactorization<double>;
+template class CholeskyFactorization<float>;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Matrix.hpp"
+#include "MatrixView.hpp"
+
+// Factorizations of a dense square matrix A, computed once and then used to solve A X = B for any number of
+// right-hand sides B, each solve costing O(n^2) per column against the O(n^3) of the factorization.
+//
+// Both are blocked and right-looking: once a panel of columns is factorized, the trailing matrix is updated tile by
+// tile with gemm. Each panel factorization, triangular solve and tile update is a task in a TaskGraph that runs as
+// soon as the tiles it reads are final, so the next panel is factorized while the rest of the previous update is
+// still running. threads is the number of threads, 0 for one per core.
+
+// P A = L U with partial pivoting, L unit lower triangular and U upper triangular.
+template<class elementType>
+class LuFactorization {
+public:
+	// Throws std::runtime_error if a is not square or is singular.
+	explicit LuFactorization(const MatrixView<elementType>& a, unsigned int threads = 0);
+
+	// Return X solving A X = B. Throws std::runtime_error if B does not have one row per row of A.
+	Matrix<elementType> solve(const MatrixView<elementType>& b, unsigned int threads = 0) const;
+
+	// L below the diagonal, its unit diagonal implied, and U on and above it.
+	const Matrix<elementType>& factors() const {
+		return lu;
+	}
+
+	// Row i of A was swapped with row pivots()[i] >= i, for i in increasing order.
+	const std::vector<size_t>& pivots() const {
+		return rowPivots;
+	}
+
+	unsigned long size() const {
+		return lu.nRows();
+	}
+
+private:
+	Matrix<elementType> lu;
+	std::vector<size_t> rowPivots;
+};
+
+// A = L L^T for a symmetric positive definite A, L lower triangular. Only the lower triangle of A is read.
+template<class elementType>
+class CholeskyFactorization {
+public:
+	// Throws std::runtime_error if a is not square or not positive definite.
+	explicit CholeskyFactorization(const MatrixView<elementType>& a, unsigned int threads = 0);
+
+	// Return X solving A X = B. Throws std::runtime_error if B does not have one row per row of A.
+	Matrix<elementType> solve(const MatrixView<elementType>& b, unsigned int threads = 0) const;
+
+	// L, zero above the diagonal.
+	const Matrix<elementType>& factor() const {
+		return l;
+	}
+
+	unsigned long size() const {
+		return l.nRows();
+	}
+
+private:
+	Matrix<elementType> l;
+};
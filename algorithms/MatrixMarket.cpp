@@ -0,0 +1,120 @@
+#include "MatrixMarket.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+MatrixMarketHeader readMatrixMarketHeader(const char* begin, const char* end, const string& filename) {
+	MatrixMarketHeader header;
+	const char* position = begin;
+	unsigned long long line = 1;
+
+	const char* lineEnd = find(position, end, '\n');
+	vector<string> banner;
+	for (const char* p = position; p != lineEnd;) {
+		for (; p != lineEnd && isMatrixTextSpace(*p); ++p) {
+		}
+		const char* tokenStart = p;
+		for (; p != lineEnd && !isMatrixTextSpace(*p); ++p) {
+		}
+		if (p != tokenStart) {
+			string token(tokenStart, p);
+			if (!banner.empty()) {
+				for (char& c : token) {
+					c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+				}
+			}
+			banner.push_back(token);
+		}
+	}
+
+	if (banner.size() != 5 || banner[0] != "%%MatrixMarket" || banner[1] != "matrix") {
+		throw matrixTextError(filename, line, 1,
+			"Expected a \"%%MatrixMarket matrix <format> <field> <symmetry>\" banner.");
+	}
+	if (banner[2] != "coordinate") {
+		throw matrixTextError(filename, line, 1, "Only coordinate Matrix Market files are supported, not \"" + banner[2] + "\".");
+	}
+
+	if (banner[3] == "real" || banner[3] == "double") {
+		header.field = MatrixMarketField::real;
+	}
+	else if (banner[3] == "integer") {
+		header.field = MatrixMarketField::integer;
+	}
+	else if (banner[3] == "pattern") {
+		header.field = MatrixMarketField::pattern;
+	}
+	else {
+		throw matrixTextError(filename, line, 1, "Unsupported Matrix Market field \"" + banner[3] + "\".");
+	}
+
+	if (banner[4] == "general") {
+		header.symmetry = MatrixMarketSymmetry::general;
+	}
+	else if (banner[4] == "symmetric") {
+		header.symmetry = MatrixMarketSymmetry::symmetric;
+	}
+	else if (banner[4] == "skew-symmetric") {
+		header.symmetry = MatrixMarketSymmetry::skewSymmetric;
+	}
+	else {
+		throw matrixTextError(filename, line, 1, "Unsupported Matrix Market symmetry \"" + banner[4] + "\".");
+	}
+
+	// Comment and blank lines, then the size line.
+	const char* p = nullptr;
+	for (;;) {
+		if (lineEnd == end) {
+			throw matrixTextError(filename, line, 1, "Expected a \"rows cols entries\" line.");
+		}
+		position = lineEnd + 1;
+		line++;
+		lineEnd = find(position, end, '\n');
+		for (p = position; p != lineEnd && isMatrixTextSpace(*p); ++p) {
+		}
+		if (p != lineEnd && *p != '%') {
+			break;
+		}
+	}
+
+	string message;
+	unsigned long long dimensions[3];
+	const char* names[3] = { "rows", "columns", "entries" };
+	for (int i = 0; i < 3; i++) {
+		for (; p != lineEnd && isMatrixTextSpace(*p); ++p) {
+		}
+		const char* parsed = p == lineEnd ? nullptr : parseMatrixTextElement(p, lineEnd, dimensions[i], message);
+		if (parsed == nullptr) {
+			throw matrixTextError(filename, line, p - position + 1,
+				p == lineEnd ? string("Expected the number of ") + names[i] + "." : message);
+		}
+		p = parsed;
+	}
+	for (; p != lineEnd && isMatrixTextSpace(*p); ++p) {
+	}
+	if (p != lineEnd) {
+		throw matrixTextError(filename, line, p - position + 1, "Unexpected text after the matrix size.");
+	}
+
+	// Sparse matrices hold 32-bit row and column indices.
+	if (dimensions[0] > UINT32_MAX || dimensions[1] > UINT32_MAX) {
+		throw matrixTextError(filename, line, 1, "A sparse matrix may have at most " + to_string(UINT32_MAX) +
+			" rows and columns.");
+	}
+	if (header.symmetry != MatrixMarketSymmetry::general && dimensions[0] != dimensions[1]) {
+		throw matrixTextError(filename, line, 1, "A symmetric matrix must be square.");
+	}
+
+	header.nRows = static_cast<unsigned long>(dimensions[0]);
+	header.nCols = static_cast<unsigned long>(dimensions[1]);
+	header.entries = dimensions[2];
+	header.bodyOffset = lineEnd == end ? end - begin : lineEnd + 1 - begin;
+	header.bodyLine = line + 1;
+	return header;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "MatrixText.hpp"
+#include "SparseMatrix.hpp"
+
+// Matrix Market coordinate files: a "%%MatrixMarket matrix coordinate <field> <symmetry>" banner, comment lines
+// starting with '%', a "rows cols entries" line and then one "row col [value]" line per entry with 1-based indices.
+// Symmetric and skew-symmetric files store one triangle, the other being implied.
+enum class MatrixMarketField { real, integer, pattern };
+enum class MatrixMarketSymmetry { general, symmetric, skewSymmetric };
+
+struct MatrixMarketHeader {
+	MatrixMarketField field;
+	MatrixMarketSymmetry symmetry;
+	unsigned long nRows;
+	unsigned long nCols;
+	unsigned long long entries;
+	// Offset of the line after the size line, and its line number.
+	size_t bodyOffset;
+	unsigned long long bodyLine;
+};
+
+// Parse everything up to the entries. Throws std::runtime_error, with the line and column, for a malformed header or
+// for array, complex and hermitian files.
+MatrixMarketHeader readMatrixMarketHeader(const char* begin, const char* end, const std::string& filename);
+
+
+template<class elementType, class Visit>
+void forEachMatrixMarketEntry(
+	const MatrixMarketHeader& header, const char* begin, const char* end, const std::string& filename, const Visit& visit) {
+	// Call visit(row, col, value) with 0-based indices for every entry, and again with row and col swapped for the
+	// implied entry mirroring each off-diagonal entry of a symmetric or skew-symmetric file. Pattern entries have the
+	// value 1.
+
+	const char* position = begin + header.bodyOffset;
+	unsigned long long line = header.bodyLine;
+	unsigned long long seen = 0;
+	std::string message;
+
+	while (position != end) {
+		const char* lineEnd = std::find(position, end, '\n');
+		const char* p = position;
+		auto skipSpace = [&]() {
+			while (p != lineEnd && isMatrixTextSpace(*p)) {
+				++p;
+			}
+		};
+		auto fail = [&](const std::string& failure) {
+			return matrixTextError(filename, line, p - position + 1, failure);
+		};
+		auto parse = [&](auto& value, const char* expected) {
+			skipSpace();
+			if (p == lineEnd) {
+				throw fail(expected);
+			}
+			const char* parsed = parseMatrixTextElement(p, lineEnd, value, message);
+			if (parsed == nullptr) {
+				throw fail(message);
+			}
+			p = parsed;
+		};
+
+		skipSpace();
+		if (p != lineEnd && *p != '%') {
+			if (seen == header.entries) {
+				throw fail("Expected " + std::to_string(header.entries) + " entries but found more.");
+			}
+
+			unsigned long long row, col;
+			elementType value = 1;
+			const char* rowStart = p;
+			parse(row, "Expected a row index.");
+			if (row == 0 || row > header.nRows) {
+				p = rowStart;
+				throw fail("Row index " + std::to_string(row) + " is outside 1.." + std::to_string(header.nRows) + ".");
+			}
+			skipSpace();
+			const char* colStart = p;
+			parse(col, "Expected a column index.");
+			if (col == 0 || col > header.nCols) {
+				p = colStart;
+				throw fail("Column index " + std::to_string(col) + " is outside 1.." + std::to_string(header.nCols) + ".");
+			}
+			if (header.field != MatrixMarketField::pattern) {
+				parse(value, "Expected a value.");
+			}
+			skipSpace();
+			if (p != lineEnd) {
+				throw fail("Unexpected text after the entry.");
+			}
+
+			visit(static_cast<unsigned long>(row - 1), static_cast<unsigned long>(col - 1), value);
+			if (header.symmetry != MatrixMarketSymmetry::general && row != col) {
+				visit(static_cast<unsigned long>(col - 1), static_cast<unsigned long>(row - 1),
+					header.symmetry == MatrixMarketSymmetry::skewSymmetric ? -value : value);
+			}
+			seen++;
+		}
+
+		position = lineEnd == end ? end : lineEnd + 1;
+		line++;
+	}
+
+	if (seen != header.entries) {
+		throw matrixTextError(filename, line, 1,
+			"Expected " + std::to_string(header.entries) + " entries but found " + std::to_string(seen) + ".");
+	}
+}
+
+
+template<class elementType>
+CsrMatrix<elementType> loadMatrixMarket(const std::string& filename) {
+	// Stream the memory-mapped file twice, first counting the entries of each row and then placing each entry in its
+	// row, so no more than the CSR arrays are ever held in memory. Entries may come in any order; each row is then
+	// sorted by column, and repeated entries summed.
+
+	MappedFile file(filename, MappedFile::Mode::read);
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+	MatrixMarketHeader header = readMatrixMarketHeader(begin, end, filename);
+
+	std::vector<size_t> offsets(static_cast<size_t>(header.nRows) + 1, 0);
+	forEachMatrixMarketEntry<elementType>(header, begin, end, filename, [&](unsigned long row, unsigned long, elementType) {
+		offsets[row + 1]++;
+	});
+	for (size_t row = 0; row < header.nRows; row++) {
+		offsets[row + 1] += offsets[row];
+	}
+
+	std::vector<uint32_t> indices(offsets.back());
+	std::vector<elementType> values(offsets.back());
+	std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	forEachMatrixMarketEntry<elementType>(header, begin, end, filename, [&](unsigned long row, unsigned long col, elementType value) {
+		size_t position = next[row]++;
+		indices[position] = static_cast<uint32_t>(col);
+		values[position] = value;
+	});
+	next = std::vector<size_t>();
+
+	size_t written = 0;
+	std::vector<std::pair<uint32_t, elementType>> unsorted;
+	for (size_t row = 0; row < header.nRows; row++) {
+		size_t first = offsets[row];
+		size_t last = offsets[row + 1];
+		if (!std::is_sorted(indices.begin() + first, indices.begin() + last)) {
+			unsorted.clear();
+			for (size_t nz = first; nz < last; nz++) {
+				unsorted.emplace_back(indices[nz], values[nz]);
+			}
+			std::stable_sort(unsorted.begin(), unsorted.end(),
+				[](const std::pair<uint32_t, elementType>& a, const std::pair<uint32_t, elementType>& b) { return a.first < b.first; });
+			for (size_t nz = first; nz < last; nz++) {
+				indices[nz] = unsorted[nz - first].first;
+				values[nz] = unsorted[nz - first].second;
+			}
+		}
+
+		offsets[row] = written;
+		for (size_t nz = first; nz < last; nz++) {
+			if (written > offsets[row] && indices[written - 1] == indices[nz]) {
+				values[written - 1] += values[nz];
+			}
+			else {
+				indices[written] = indices[nz];
+				values[written] = values[nz];
+				written++;
+			}
+		}
+	}
+	offsets[header.nRows] = written;
+	indices.resize(written);
+	values.resize(written);
+	indices.shrink_to_fit();
+	values.shrink_to_fit();
+
+	return CsrMatrix<elementType>(header.nRows, header.nCols, std::move(offsets), std::move(indices), std::move(values));
+}
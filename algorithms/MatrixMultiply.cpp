@@ -0,0 +1,357 @@
+#include "MatrixMultiply.hpp"
+#include "Parallel.hpp"
+
+#include <vector>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+// Register and cache blocking for one element type. A microkernel call multiplies an mr x kc sliver of packed A by a
+// kc x nr sliver of packed B; kc is chosen so the B sliver stays in L1 across the mc / mr calls that reuse it, mc so
+// the packed A block stays in L2, and nc so the packed B panel fits in L3.
+template<class elementType> struct GemmBlocking;
+
+template<> struct GemmBlocking<double> {
+	static constexpr size_t mr = 6;
+	static constexpr size_t nr = 8;
+	static constexpr size_t mc = 96;
+	static constexpr size_t kc = 256;
+	static constexpr size_t nc = 2048;
+};
+
+template<> struct GemmBlocking<float> {
+	static constexpr size_t mr = 6;
+	static constexpr size_t nr = 16;
+	static constexpr size_t mc = 96;
+	static constexpr size_t kc = 256;
+	static constexpr size_t nc = 4096;
+};
+
+// Below this many multiply-adds the product runs on the calling thread, as starting threads would cost more.
+static const double gemmParallelThreshold = 1 << 21;
+
+
+template<class elementType>
+static void gemmKernelScalar(size_t kc, const elementType* a, const elementType* b, elementType* tile) {
+	// tile := the mr x nr product of the packed slivers a (kc columns of mr) and b (kc rows of nr).
+
+	const size_t mr = GemmBlocking<elementType>::mr;
+	const size_t nr = GemmBlocking<elementType>::nr;
+
+	elementType accumulators[mr * nr] = {};
+	for (size_t p = 0; p < kc; p++) {
+		for (size_t i = 0; i < mr; i++) {
+			elementType ai = a[i];
+			for (size_t j = 0; j < nr; j++) {
+				accumulators[i * nr + j] += ai * b[j];
+			}
+		}
+		a += mr;
+		b += nr;
+	}
+
+	copy(accumulators, accumulators + mr * nr, tile);
+}
+
+
+#ifdef __AVX2__
+static void gemmKernel(size_t kc, const double* a, const double* b, double* tile) {
+	// The 6 x 8 tile lives in twelve ymm registers. Each step broadcasts one element of the A column against the two
+	// vectors of the B row, 12 FMAs for 2 loads and 6 broadcasts.
+
+	__m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+	__m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+	__m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+	__m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+	__m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+	__m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+	for (size_t p = 0; p < kc; p++) {
+		__m256d b0 = _mm256_loadu_pd(b);
+		__m256d b1 = _mm256_loadu_pd(b + 4);
+		__m256d ai;
+
+		ai = _mm256_broadcast_sd(a);
+		c00 = _mm256_fmadd_pd(ai, b0, c00);
+		c01 = _mm256_fmadd_pd(ai, b1, c01);
+		ai = _mm256_broadcast_sd(a + 1);
+		c10 = _mm256_fmadd_pd(ai, b0, c10);
+		c11 = _mm256_fmadd_pd(ai, b1, c11);
+		ai = _mm256_broadcast_sd(a + 2);
+		c20 = _mm256_fmadd_pd(ai, b0, c20);
+		c21 = _mm256_fmadd_pd(ai, b1, c21);
+		ai = _mm256_broadcast_sd(a + 3);
+		c30 = _mm256_fmadd_pd(ai, b0, c30);
+		c31 = _mm256_fmadd_pd(ai, b1, c31);
+		ai = _mm256_broadcast_sd(a + 4);
+		c40 = _mm256_fmadd_pd(ai, b0, c40);
+		c41 = _mm256_fmadd_pd(ai, b1, c41);
+		ai = _mm256_broadcast_sd(a + 5);
+		c50 = _mm256_fmadd_pd(ai, b0, c50);
+		c51 = _mm256_fmadd_pd(ai, b1, c51);
+
+		a += 6;
+		b += 8;
+	}
+
+	_mm256_storeu_pd(tile, c00);
+	_mm256_storeu_pd(tile + 4, c01);
+	_mm256_storeu_pd(tile + 8, c10);
+	_mm256_storeu_pd(tile + 12, c11);
+	_mm256_storeu_pd(tile + 16, c20);
+	_mm256_storeu_pd(tile + 20, c21);
+	_mm256_storeu_pd(tile + 24, c30);
+	_mm256_storeu_pd(tile + 28, c31);
+	_mm256_storeu_pd(tile + 32, c40);
+	_mm256_storeu_pd(tile + 36, c41);
+	_mm256_storeu_pd(tile + 40, c50);
+	_mm256_storeu_pd(tile + 44, c51);
+}
+
+static void gemmKernel(size_t kc, const float* a, const float* b, float* tile) {
+	// The single precision tile is 6 x 16, the same twelve ymm registers holding twice the elements.
+
+	__m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+	__m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+	__m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+	__m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+	__m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+	__m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+	for (size_t p = 0; p < kc; p++) {
+		__m256 b0 = _mm256_loadu_ps(b);
+		__m256 b1 = _mm256_loadu_ps(b + 8);
+		__m256 ai;
+
+		ai = _mm256_broadcast_ss(a);
+		c00 = _mm256_fmadd_ps(ai, b0, c00);
+		c01 = _mm256_fmadd_ps(ai, b1, c01);
+		ai = _mm256_broadcast_ss(a + 1);
+		c10 = _mm256_fmadd_ps(ai, b0, c10);
+		c11 = _mm256_fmadd_ps(ai, b1, c11);
+		ai = _mm256_broadcast_ss(a + 2);
+		c20 = _mm256_fmadd_ps(ai, b0, c20);
+		c21 = _mm256_fmadd_ps(ai, b1, c21);
+		ai = _mm256_broadcast_ss(a + 3);
+		c30 = _mm256_fmadd_ps(ai, b0, c30);
+		c31 = _mm256_fmadd_ps(ai, b1, c31);
+		ai = _mm256_broadcast_ss(a + 4);
+		c40 = _mm256_fmadd_ps(ai, b0, c40);
+		c41 = _mm256_fmadd_ps(ai, b1, c41);
+		ai = _mm256_broadcast_ss(a + 5);
+		c50 = _mm256_fmadd_ps(ai, b0, c50);
+		c51 = _mm256_fmadd_ps(ai, b1, c51);
+
+		a += 6;
+		b += 16;
+	}
+
+	_mm256_storeu_ps(tile, c00);
+	_mm256_storeu_ps(tile + 8, c01);
+	_mm256_storeu_ps(tile + 16, c10);
+	_mm256_storeu_ps(tile + 24, c11);
+	_mm256_storeu_ps(tile + 32, c20);
+	_mm256_storeu_ps(tile + 40, c21);
+	_mm256_storeu_ps(tile + 48, c30);
+	_mm256_storeu_ps(tile + 56, c31);
+	_mm256_storeu_ps(tile + 64, c40);
+	_mm256_storeu_ps(tile + 72, c41);
+	_mm256_storeu_ps(tile + 80, c50);
+	_mm256_storeu_ps(tile + 88, c51);
+}
+#else
+template<class elementType>
+static void gemmKernel(size_t kc, const elementType* a, const elementType* b, elementType* tile) {
+	gemmKernelScalar(kc, a, b, tile);
+}
+#endif
+
+
+template<class elementType>
+static void packA(
+	Transpose transposeA, const elementType* a, size_t lda, size_t ic, size_t mc, size_t pc, size_t kc,
+	elementType* packed) {
+	// Copy rows ic..ic+mc-1, columns pc..pc+kc-1 of op(A) into slivers of mr rows, each stored column by column so the
+	// microkernel reads it sequentially. Rows past the end of the last sliver are zero.
+
+	const size_t mr = GemmBlocking<elementType>::mr;
+
+	for (size_t ir = 0; ir < mc; ir += mr) {
+		size_t rows = min(mr, mc - ir);
+		for (size_t p = 0; p < kc; p++) {
+			for (size_t i = 0; i < rows; i++) {
+				size_t row = ic + ir + i;
+				size_t col = pc + p;
+				packed[i] = transposeA == Transpose::yes ? a[col * lda + row] : a[row * lda + col];
+			}
+			for (size_t i = rows; i < mr; i++) {
+				packed[i] = 0;
+			}
+			packed += mr;
+		}
+	}
+}
+
+
+template<class elementType>
+static void packB(
+	Transpose transposeB, const elementType* b, size_t ldb, size_t pc, size_t kc, size_t jc, size_t nc,
+	size_t firstSliver, size_t lastSliver, elementType* packed) {
+	// Copy slivers firstSliver..lastSliver-1 of rows pc..pc+kc-1, columns jc..jc+nc-1 of op(B), each nr columns wide
+	// and stored row by row. Columns past the end of the last sliver are zero.
+
+	const size_t nr = GemmBlocking<elementType>::nr;
+
+	packed += firstSliver * kc * nr;
+	for (size_t sliver = firstSliver; sliver < lastSliver; sliver++) {
+		size_t jr = sliver * nr;
+		size_t cols = min(nr, nc - jr);
+		for (size_t p = 0; p < kc; p++) {
+			for (size_t j = 0; j < cols; j++) {
+				size_t row = pc + p;
+				size_t col = jc + jr + j;
+				packed[j] = transposeB == Transpose::yes ? b[col * ldb + row] : b[row * ldb + col];
+			}
+			for (size_t j = cols; j < nr; j++) {
+				packed[j] = 0;
+			}
+			packed += nr;
+		}
+	}
+}
+
+
+template<class elementType>
+static void updateTile(
+	const elementType* tile, size_t rows, size_t cols, elementType alpha, elementType beta, elementType* c, size_t ldc) {
+	// C := alpha * tile + beta * C over the rows x cols corner of the tile, without reading C when beta is 0.
+
+	const size_t nr = GemmBlocking<elementType>::nr;
+
+	for (size_t i = 0; i < rows; i++) {
+		elementType* cRow = c + i * ldc;
+		const elementType* tileRow = tile + i * nr;
+		if (beta == 0) {
+			for (size_t j = 0; j < cols; j++) {
+				cRow[j] = alpha * tileRow[j];
+			}
+		}
+		else if (beta == 1) {
+			for (size_t j = 0; j < cols; j++) {
+				cRow[j] += alpha * tileRow[j];
+			}
+		}
+		else {
+			for (size_t j = 0; j < cols; j++) {
+				cRow[j] = alpha * tileRow[j] + beta * cRow[j];
+			}
+		}
+	}
+}
+
+
+template<class elementType>
+static void gemmBlocked(
+	Transpose transposeA, Transpose transposeB, size_t m, size_t n, size_t k,
+	elementType alpha, const elementType* a, size_t lda, const elementType* b, size_t ldb,
+	elementType beta, elementType* c, size_t ldc, unsigned int threads) {
+	typedef GemmBlocking<elementType> Blocking;
+
+	if (m == 0 || n == 0) {
+		return;
+	}
+
+	if (k == 0 || alpha == 0) {
+		for (size_t i = 0; i < m; i++) {
+			for (size_t j = 0; j < n; j++) {
+				c[i * ldc + j] = beta == 0 ? 0 : beta * c[i * ldc + j];
+			}
+		}
+		return;
+	}
+
+	threads = resolveThreadCount(threads);
+	if (static_cast<double>(m) * n * k < gemmParallelThreshold) {
+		threads = 1;
+	}
+
+	// Packing buffers are sized for the largest blocks this product has, so small products do not fill full-sized ones.
+	size_t mBlocks = (m + Blocking::mc - 1) / Blocking::mc;
+	size_t kcMax = min(Blocking::kc, k);
+	size_t mcMax = min(Blocking::mc, (m + Blocking::mr - 1) / Blocking::mr * Blocking::mr);
+	size_t ncMax = min(Blocking::nc, (n + Blocking::nr - 1) / Blocking::nr * Blocking::nr);
+	vector<elementType> packedB(kcMax * ncMax);
+
+	for (size_t jc = 0; jc < n; jc += Blocking::nc) {
+		size_t nc = min(Blocking::nc, n - jc);
+		size_t bSlivers = (nc + Blocking::nr - 1) / Blocking::nr;
+
+		for (size_t pc = 0; pc < k; pc += Blocking::kc) {
+			size_t kc = min(Blocking::kc, k - pc);
+			// Earlier blocks of k have already applied beta, so later ones accumulate.
+			elementType blockBeta = pc == 0 ? beta : elementType(1);
+
+			parallelFor(bSlivers, threads, [&](size_t begin, size_t end) {
+				packB(transposeB, b, ldb, pc, kc, jc, nc, begin, end, packedB.data());
+			});
+
+			// Each task is one block of mc rows of C against a group of B slivers. With fewer row blocks than threads
+			// the columns are split too, so short and wide products still use every thread. Consecutive tasks share
+			// a row block, letting a thread reuse the A block it packed.
+			size_t columnGroups = min(bSlivers, max<size_t>(1, (threads + mBlocks - 1) / mBlocks));
+			size_t tasks = mBlocks * columnGroups;
+
+			parallelFor(tasks, threads, [&](size_t begin, size_t end) {
+				vector<elementType> packedA(mcMax * kcMax);
+				elementType tile[Blocking::mr * Blocking::nr];
+				size_t packedBlock = mBlocks;
+
+				for (size_t task = begin; task < end; task++) {
+					size_t block = task / columnGroups;
+					size_t group = task % columnGroups;
+					size_t ic = block * Blocking::mc;
+					size_t mc = min(Blocking::mc, m - ic);
+					if (block != packedBlock) {
+						packA(transposeA, a, lda, ic, mc, pc, kc, packedA.data());
+						packedBlock = block;
+					}
+
+					size_t firstSliver = bSlivers * group / columnGroups;
+					size_t lastSliver = bSlivers * (group + 1) / columnGroups;
+					for (size_t sliver = firstSliver; sliver < lastSliver; sliver++) {
+						size_t jr = sliver * Blocking::nr;
+						size_t cols = min(Blocking::nr, nc - jr);
+						const elementType* bSliver = packedB.data() + sliver * kc * Blocking::nr;
+
+						for (size_t ir = 0; ir < mc; ir += Blocking::mr) {
+							size_t rows = min(Blocking::mr, mc - ir);
+							gemmKernel(kc, packedA.data() + ir * kc, bSliver, tile);
+							updateTile(tile, rows, cols, alpha, blockBeta, c + (ic + ir) * ldc + jc + jr, ldc);
+						}
+					}
+				}
+			});
+		}
+	}
+}
+
+
+void gemm(
+	Transpose transposeA, Transpose transposeB, size_t m, size_t n, size_t k,
+	double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+	double beta, double* c, size_t ldc, unsigned int threads) {
+	gemmBlocked(transposeA, transposeB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, threads);
+}
+
+
+void gemm(
+	Transpose transposeA, Transpose transposeB, size_t m, size_t n, size_t k,
+	float alpha, const float* a, size_t lda, const float* b, size_t ldb,
+	float beta, float* c, size_t ldc, unsigned int threads) {
+	gemmBlocked(transposeA, transposeB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, threads);
+}
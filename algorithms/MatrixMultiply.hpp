@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "Matrix.hpp"
+#include "MatrixView.hpp"
+
+enum class Transpose { no, yes };
+
+// C := alpha * op(A) * op(B) + beta * C for row-major matrices, where op(X) is X or its transpose. op(A) is m x k and
+// op(B) is k x n. lda, ldb and ldc are the distances in elements between consecutive stored rows of A, B and C, so A is
+// stored m x k, or k x m when transposed. When beta is 0, C is not read and may hold anything.
+//
+// The product is blocked as in GotoBLAS: B is packed in kc x nc panels that stay in L3, A in mc x kc blocks that stay in
+// L2, and a register-blocked microkernel (AVX2 and FMA when compiled for them) accumulates an mr x nr tile of C from
+// one packed A sliver and one packed B sliver in L1. Tiles of C are shared out over threads, 0 for one per core.
+void gemm(
+	Transpose transposeA, Transpose transposeB, size_t m, size_t n, size_t k,
+	double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+	double beta, double* c, size_t ldc, unsigned int threads = 0);
+void gemm(
+	Transpose transposeA, Transpose transposeB, size_t m, size_t n, size_t k,
+	float alpha, const float* a, size_t lda, const float* b, size_t ldb,
+	float beta, float* c, size_t ldc, unsigned int threads = 0);
+
+// Point gemm at the elements of view. A view with contiguous rows is passed as it is, and one with contiguous columns,
+// such as a transpose, as the transpose of its stored layout. Other strided views are first copied into copy.
+template<class elementType>
+const elementType* gemmOperand(
+	const MatrixView<elementType>& view, Transpose& transpose, size_t& leadingDimension, Matrix<elementType>& copy) {
+	if (view.colStride() == 1) {
+		leadingDimension = view.nRows() > 1 ? view.rowStride() : view.nCols();
+		return view.data();
+	}
+	if (view.rowStride() == 1) {
+		transpose = transpose == Transpose::yes ? Transpose::no : Transpose::yes;
+		leadingDimension = view.nCols() > 1 ? view.colStride() : view.nRows();
+		return view.data();
+	}
+
+	copy = view;
+	leadingDimension = view.nCols();
+	return copy.data();
+}
+
+// Return op(A) * op(B). A and B may be any views, including blocks and transposes of other matrices. Throws
+// std::runtime_error when the inner dimensions differ.
+template<class elementType>
+Matrix<elementType> multiply(
+	const MatrixView<elementType>& a, const MatrixView<elementType>& b,
+	Transpose transposeA = Transpose::no, Transpose transposeB = Transpose::no, unsigned int threads = 0) {
+	unsigned long m = transposeA == Transpose::yes ? a.nCols() : a.nRows();
+	unsigned long k = transposeA == Transpose::yes ? a.nRows() : a.nCols();
+	unsigned long bRows = transposeB == Transpose::yes ? b.nCols() : b.nRows();
+	unsigned long n = transposeB == Transpose::yes ? b.nRows() : b.nCols();
+	if (k != bRows) {
+		throw std::runtime_error("Cannot multiply a " + std::to_string(m) + "x" + std::to_string(k) + " matrix by a " +
+			std::to_string(bRows) + "x" + std::to_string(n) + " matrix.");
+	}
+
+	Matrix<elementType> aCopy(0, 0), bCopy(0, 0);
+	size_t lda, ldb;
+	const elementType* aElements = gemmOperand(a, transposeA, lda, aCopy);
+	const elementType* bElements = gemmOperand(b, transposeB, ldb, bCopy);
+
+	// gemm overwrites every element when beta is 0, so the product's storage is left uninitialized.
+	Matrix<elementType> product(m, n, MatrixStorage<elementType>(static_cast<size_t>(m) * n));
+	gemm(transposeA, transposeB, m, n, k,
+		elementType(1), aElements, lda, bElements, ldb, elementType(0), product.data(), n, threads);
+
+	return product;
+}
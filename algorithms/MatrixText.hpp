@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+// Parsing of matrices in the text format "nRows nCols" followed by nRows*nCols whitespace separated elements in
+// row-major order. The file is memory mapped and split into line-aligned chunks. A first parallel pass counts the
+// elements and lines of each chunk, so each chunk knows the index of its first element and line, and a second
+// parallel pass parses each chunk with std::from_chars straight into the element buffer. Malformed input throws
+// std::runtime_error with "file:line:column: " in front of the message.
+
+inline bool isMatrixTextSpace(char c) {
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+
+inline std::runtime_error matrixTextError(
+	const std::string& filename, unsigned long long line, unsigned long long column, const std::string& message) {
+	return std::runtime_error(filename + ":" + std::to_string(line) + ":" + std::to_string(column) + ": " + message);
+}
+
+
+template<class elementType>
+const char* parseMatrixTextElement(const char* first, const char* last, elementType& value, std::string& message) {
+	// Parse the element at first and return the end of it, or set message and return nullptr if it is malformed or
+	// runs into something other than whitespace. A leading '+' is accepted, as operator>> accepts it.
+
+	const char* start = first;
+	if (first != last && *first == '+' && first + 1 != last && first[1] != '-') {
+		++first;
+	}
+
+	auto result = std::from_chars(first, last, value);
+	if (result.ec == std::errc::result_out_of_range) {
+		message = "Element " + std::string(start, result.ptr) + " is out of range.";
+		return nullptr;
+	}
+	if (result.ec != std::errc() || (result.ptr != last && !isMatrixTextSpace(*result.ptr))) {
+		const char* tokenEnd = start;
+		while (tokenEnd != last && !isMatrixTextSpace(*tokenEnd)) {
+			++tokenEnd;
+		}
+		message = "Cannot parse element " + std::string(start, tokenEnd) + ".";
+		return nullptr;
+	}
+
+	return result.ptr;
+}
+
+
+template<class elementType, class Allocate>
+void parseMatrixText(const std::string& filename, unsigned int threads, const Allocate& allocate) {
+	// Parse the matrix in filename into the buffer allocate(nRows, nCols) returns, which must hold nRows*nCols
+	// elements.
+
+	MappedFile file(filename, MappedFile::Mode::read);
+	const char* const begin = file.data();
+	const char* const end = begin + file.size();
+
+	// Read the dimensions.
+	const char* position = begin;
+	const char* lineStart = begin;
+	unsigned long long line = 1;
+	std::string message;
+	unsigned long nRows, nCols;
+	auto skipSpace = [&]() {
+		for (; position != end && isMatrixTextSpace(*position); ++position) {
+			if (*position == '\n') {
+				line++;
+				lineStart = position + 1;
+			}
+		}
+	};
+	unsigned long long colsLine = line;
+	unsigned long long colsColumn = 1;
+	for (unsigned long* dimension : { &nRows, &nCols }) {
+		skipSpace();
+		colsLine = line;
+		colsColumn = position - lineStart + 1;
+		const char* parsed = position == end ? nullptr : parseMatrixTextElement(position, end, *dimension, message);
+		if (parsed == nullptr) {
+			throw matrixTextError(filename, line, position - lineStart + 1,
+				dimension == &nRows ? "Expected the number of rows." : "Expected the number of columns.");
+		}
+		position = parsed;
+	}
+	if (nCols != 0 && nRows > std::numeric_limits<size_t>::max() / nCols) {
+		throw matrixTextError(filename, colsLine, colsColumn,
+			"A " + std::to_string(nRows) + "x" + std::to_string(nCols) + " matrix is too large.");
+	}
+	const size_t count = static_cast<size_t>(nRows) * nCols;
+
+	// Split the rest into chunks starting just after a newline, a few per thread so uneven lines balance out.
+	const size_t minimumChunkBytes = 1 << 20;
+	threads = resolveThreadCount(threads);
+	size_t bodyBytes = end - position;
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(4 * threads, bodyBytes / minimumChunkBytes));
+	std::vector<const char*> bounds(chunkCount + 1, end);
+	bounds[0] = position;
+	for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+		const char* split = std::max(bounds[chunk - 1], position + bodyBytes / chunkCount * chunk);
+		while (split != end && *split++ != '\n') {}
+		bounds[chunk] = split;
+	}
+
+	struct ChunkInfo {
+		size_t elements;
+		unsigned long long lines;
+		size_t firstElement;
+		unsigned long long firstLine;
+		const char* firstLineStart;
+		bool failed;
+		unsigned long long errorLine;
+		unsigned long long errorColumn;
+		std::string errorMessage;
+	};
+	std::vector<ChunkInfo> chunks(chunkCount);
+
+	parallelFor(chunkCount, threads, [&](size_t firstChunk, size_t lastChunk) {
+		for (size_t chunk = firstChunk; chunk < lastChunk; chunk++) {
+			size_t elements = 0;
+			unsigned long long lines = 0;
+			bool inElement = false;
+			for (const char* c = bounds[chunk]; c != bounds[chunk + 1]; ++c) {
+				bool space = isMatrixTextSpace(*c);
+				elements += !space && !inElement;
+				lines += *c == '\n';
+				inElement = !space;
+			}
+			chunks[chunk].elements = elements;
+			chunks[chunk].lines = lines;
+			chunks[chunk].failed = false;
+		}
+	});
+
+	size_t totalElements = 0;
+	for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+		chunks[chunk].firstElement = totalElements;
+		chunks[chunk].firstLine = chunk == 0 ? line : chunks[chunk - 1].firstLine + chunks[chunk - 1].lines;
+		chunks[chunk].firstLineStart = chunk == 0 ? lineStart : bounds[chunk];
+		totalElements += chunks[chunk].elements;
+	}
+
+	// Check the count before allocating, so a short file claiming huge dimensions fails with the count rather than
+	// running out of memory. Extra elements are reported where the first of them starts.
+	if (totalElements < count) {
+		const char* lastLineStart = end;
+		while (lastLineStart != begin && lastLineStart[-1] != '\n') {
+			--lastLineStart;
+		}
+		const ChunkInfo& last = chunks.back();
+		throw matrixTextError(filename, last.firstLine + last.lines, end - lastLineStart + 1,
+			"Expected " + std::to_string(count) + " elements but found " + std::to_string(totalElements) + ".");
+	}
+	if (totalElements > count) {
+		size_t chunk = 0;
+		while (chunks[chunk].firstElement + chunks[chunk].elements <= count) {
+			chunk++;
+		}
+		const char* currentLineStart = chunks[chunk].firstLineStart;
+		unsigned long long currentLine = chunks[chunk].firstLine;
+		size_t index = chunks[chunk].firstElement;
+		bool inElement = false;
+		for (const char* c = bounds[chunk];; ++c) {
+			if (!isMatrixTextSpace(*c) && !inElement && index++ == count) {
+				throw matrixTextError(filename, currentLine, c - currentLineStart + 1,
+					"More than " + std::to_string(count) + " elements.");
+			}
+			inElement = !isMatrixTextSpace(*c);
+			if (*c == '\n') {
+				currentLine++;
+				currentLineStart = c + 1;
+			}
+		}
+	}
+
+	elementType* elements = allocate(nRows, nCols);
+
+	parallelFor(chunkCount, threads, [&](size_t firstChunk, size_t lastChunk) {
+		for (size_t chunk = firstChunk; chunk < lastChunk; chunk++) {
+			ChunkInfo& info = chunks[chunk];
+			const char* c = bounds[chunk];
+			const char* chunkEnd = bounds[chunk + 1];
+			const char* currentLineStart = info.firstLineStart;
+			unsigned long long currentLine = info.firstLine;
+			size_t index = info.firstElement;
+			while (true) {
+				for (; c != chunkEnd && isMatrixTextSpace(*c); ++c) {
+					if (*c == '\n') {
+						currentLine++;
+						currentLineStart = c + 1;
+					}
+				}
+				if (c == chunkEnd) {
+					break;
+				}
+
+				std::string error;
+				const char* parsed = parseMatrixTextElement(c, chunkEnd, elements[index], error);
+				if (parsed == nullptr) {
+					info.failed = true;
+					info.errorLine = currentLine;
+					info.errorColumn = c - currentLineStart + 1;
+					info.errorMessage = error;
+					break;
+				}
+				c = parsed;
+				index++;
+			}
+		}
+	});
+
+	for (const ChunkInfo& info : chunks) {
+		if (info.failed) {
+			throw matrixTextError(filename, info.errorLine, info.errorColumn, info.errorMessage);
+		}
+	}
+}
+
+
+template<class elementType, class Allocator = std::allocator<elementType>>
+std::vector<elementType, Allocator> loadMatrixText(
+	const std::string& filename, unsigned int threads, unsigned long& nRows, unsigned long& nCols,
+	const Allocator& allocator = Allocator()) {
+	std::vector<elementType, Allocator> elements(allocator);
+	parseMatrixText<elementType>(filename, threads, [&](unsigned long rows, unsigned long cols) {
+		nRows = rows;
+		nCols = cols;
+		elements.resize(static_cast<size_t>(rows) * cols);
+		return elements.data();
+	});
+
+	return elements;
+}
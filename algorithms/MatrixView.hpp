@@ -0,0 +1,130 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+
+#include "MatrixExpression.hpp"
+
+// Non-owning, read-only view of a matrix held elsewhere, such as in a Matrix or a memory-mapped file. Element
+// (row, col) is data()[row * rowStride() + col * colStride()], so rows, columns, blocks and the transpose of a matrix
+// are views of the same elements, made in constant time without copying. The viewed elements must outlive the view.
+template<class elementType>
+class MatrixView : public MatrixExpression<MatrixView<elementType>> {
+public:
+	typedef elementType value_type;
+
+	MatrixView() :
+		elements(nullptr),
+		rows(0),
+		cols(0),
+		rowStep(0),
+		colStep(1) {}
+
+	// View of contiguous row-major elements.
+	MatrixView(const elementType* data, unsigned long dataRows, unsigned long dataCols) :
+		elements(data),
+		rows(dataRows),
+		cols(dataCols),
+		rowStep(dataCols),
+		colStep(1) {}
+
+	MatrixView(const elementType* data, unsigned long dataRows, unsigned long dataCols, size_t rowStride, size_t colStride) :
+		elements(data),
+		rows(dataRows),
+		cols(dataCols),
+		rowStep(rowStride),
+		colStep(colStride) {}
+
+	elementType operator()(unsigned long row, unsigned long col) const {
+		return elements[row * rowStep + col * colStep];
+	}
+
+	// Return the block of blockRows x blockCols elements whose top left element is (firstRow, firstCol).
+	// Throws std::runtime_error if the block does not lie within the view.
+	MatrixView block(unsigned long firstRow, unsigned long firstCol, unsigned long blockRows, unsigned long blockCols) const {
+		if (firstRow > rows || blockRows > rows - firstRow || firstCol > cols || blockCols > cols - firstCol) {
+			throw std::runtime_error("Block of " + std::to_string(blockRows) + "x" + std::to_string(blockCols) +
+				" at (" + std::to_string(firstRow) + ", " + std::to_string(firstCol) + ") is outside a " +
+				std::to_string(rows) + "x" + std::to_string(cols) + " matrix.");
+		}
+		return MatrixView(elements + firstRow * rowStep + firstCol * colStep, blockRows, blockCols, rowStep, colStep);
+	}
+
+	MatrixView row(unsigned long index) const {
+		return block(index, 0, 1, cols);
+	}
+
+	MatrixView col(unsigned long index) const {
+		return block(0, index, rows, 1);
+	}
+
+	MatrixView rowRange(unsigned long first, unsigned long count) const {
+		return block(first, 0, count, cols);
+	}
+
+	MatrixView colRange(unsigned long first, unsigned long count) const {
+		return block(0, first, rows, count);
+	}
+
+	MatrixView transpose() const {
+		return MatrixView(elements, cols, rows, colStep, rowStep);
+	}
+
+	const elementType* data() const {
+		return elements;
+	}
+
+	unsigned long nRows() const {
+		return rows;
+	}
+
+	unsigned long nCols() const {
+		return cols;
+	}
+
+	size_t rowStride() const {
+		return rowStep;
+	}
+
+	size_t colStride() const {
+		return colStep;
+	}
+
+	// True if the elements are stored row after row with no gaps, as in a Matrix or a binary matrix file.
+	bool isContiguous() const {
+		return colStep == 1 && (rowStep == cols || rows <= 1);
+	}
+
+	// True if any viewed element is stored in [first, last).
+	bool readsWithin(const void* first, const void* last) const {
+		if (rows == 0 || cols == 0) {
+			return false;
+		}
+		const elementType* end = elements + (rows - 1) * rowStep + (cols - 1) * colStep + 1;
+		std::less<const void*> before;
+		return before(elements, last) && before(first, end);
+	}
+
+private:
+	const elementType* elements;
+	unsigned long rows;
+	unsigned long cols;
+	size_t rowStep;
+	size_t colStep;
+};
+
+template<class elementType>
+std::ostream& operator<<(std::ostream& os, const MatrixView<elementType>& matrix) {
+	for (unsigned long row = 0; row < matrix.nRows(); ++row) {
+		os << "[";
+		for (unsigned long col = 0; col < matrix.nCols(); ++col) {
+			os << matrix(row, col);
+			os << (col == matrix.nCols() - 1 ? "]" : ", ");
+		}
+		os << "\n";
+	}
+
+	return os;
+}
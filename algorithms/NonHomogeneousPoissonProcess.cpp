@@ -0,0 +1,207 @@
+#include "NonHomogeneousPoissonProcess.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+
+bool parseRateInterpolation(const string& name, RateInterpolation& interpolation) {
+	if (name == "constant") {
+		interpolation = RateInterpolation::constant;
+	}
+	else if (name == "linear") {
+		interpolation = RateInterpolation::linear;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+
+RateProfile::RateProfile(const vector<double>& times, const vector<double>& rates, RateInterpolation rateInterpolation) :
+	knotTimes(times),
+	knotRates(rates),
+	knotIntensities(times.size(), 0),
+	interpolation(rateInterpolation) {
+	if (knotTimes.size() < 2 || knotTimes.size() != knotRates.size()) {
+		throw runtime_error("A rate profile needs at least two knots, each with a time and a rate.");
+	}
+
+	for (size_t i = 0; i + 1 < knotTimes.size(); i++) {
+		double length = knotTimes[i + 1] - knotTimes[i];
+		if (!(length > 0)) {
+			throw runtime_error("Rate profile times must be increasing.");
+		}
+		if (knotRates[i] < 0 || knotRates[i + 1] < 0) {
+			throw runtime_error("Rate profile rates must not be negative.");
+		}
+
+		double segmentIntensity = interpolation == RateInterpolation::constant ?
+			knotRates[i] * length :
+			(knotRates[i] + knotRates[i + 1]) / 2 * length;
+		knotIntensities[i + 1] = knotIntensities[i] + segmentIntensity;
+	}
+
+	if (!(periodIntensity() > 0)) {
+		throw runtime_error("Rate profile has no arrivals.");
+	}
+}
+
+
+double RateProfile::period() const {
+	return knotTimes.back() - knotTimes.front();
+}
+
+
+double RateProfile::periodIntensity() const {
+	return knotIntensities.back();
+}
+
+
+size_t RateProfile::segmentAt(double time) const {
+	// Return i with t_i <= time < t_(i+1), for t_0 <= time < t_n.
+	size_t after = upper_bound(knotTimes.begin(), knotTimes.end(), time) - knotTimes.begin();
+	return min(after, knotTimes.size() - 1) - 1;
+}
+
+
+double RateProfile::rate(double time) const {
+	double offset = fmod(time - knotTimes.front(), period());
+	if (offset < 0) {
+		offset += period();
+	}
+	double local = knotTimes.front() + offset;
+
+	size_t i = segmentAt(local);
+	if (interpolation == RateInterpolation::constant) {
+		return knotRates[i];
+	}
+
+	double fraction = (local - knotTimes[i]) / (knotTimes[i + 1] - knotTimes[i]);
+	return knotRates[i] + fraction * (knotRates[i + 1] - knotRates[i]);
+}
+
+
+double RateProfile::cumulativeIntensity(double time) const {
+	// C(t) = k * C(t_n) + C(t_0 + r) for t = t_0 + k * period + r.
+	double periods = floor((time - knotTimes.front()) / period());
+	double local = min(max(time - periods * period(), knotTimes.front()), knotTimes.back());
+
+	size_t i = segmentAt(local);
+	double x = local - knotTimes[i];
+	double segmentIntensity = knotRates[i] * x;
+	if (interpolation == RateInterpolation::linear) {
+		double slope = (knotRates[i + 1] - knotRates[i]) / (knotTimes[i + 1] - knotTimes[i]);
+		segmentIntensity += slope * x * x / 2;
+	}
+
+	return periods * periodIntensity() + knotIntensities[i] + segmentIntensity;
+}
+
+
+double RateProfile::inverseCumulativeIntensity(double intensity) const {
+	// Find the period and then the segment i with C_i <= intensity < C_(i+1), skipping segments with zero rate, and
+	// solve for the offset x into it: L_i * x = d when constant, L_i * x + s * x^2 / 2 = d when linear with slope s.
+	// The root of the quadratic is taken as 2d / (L_i + sqrt(L_i^2 + 2sd)), which does not cancel when s is small.
+	double periods = floor(intensity / periodIntensity());
+	double local = min(max(intensity - periods * periodIntensity(), 0.0), periodIntensity());
+
+	size_t after = upper_bound(knotIntensities.begin(), knotIntensities.end(), local) - knotIntensities.begin();
+	size_t i = min(after, knotIntensities.size() - 1) - 1;
+	double remainder = local - knotIntensities[i];
+
+	double x;
+	if (remainder <= 0) {
+		x = 0;
+	}
+	else if (interpolation == RateInterpolation::constant) {
+		x = remainder / knotRates[i];
+	}
+	else {
+		double slope = (knotRates[i + 1] - knotRates[i]) / (knotTimes[i + 1] - knotTimes[i]);
+		double discriminant = max(knotRates[i] * knotRates[i] + 2 * slope * remainder, 0.0);
+		x = 2 * remainder / (knotRates[i] + sqrt(discriminant));
+	}
+	x = min(x, knotTimes[i + 1] - knotTimes[i]);
+
+	return knotTimes[i] + x + periods * period();
+}
+
+
+void RateProfile::transformUnitArrivalTimes(double* times, size_t count, unsigned int threads) const {
+	parallelFor(count, threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			times[i] = inverseCumulativeIntensity(times[i]);
+		}
+	});
+}
+
+
+RateProfile loadRateProfile(const string& filename, RateInterpolation interpolation) {
+	// Read whitespace separated "time rate" pairs, one knot per pair, in increasing order of time.
+
+	ifstream profileFile(filename);
+	if (!profileFile) {
+		throw runtime_error("Cannot open " + filename + ".");
+	}
+
+	vector<double> times;
+	vector<double> rates;
+	double time, rate;
+	while (profileFile >> time >> rate) {
+		times.push_back(time);
+		rates.push_back(rate);
+	}
+	if (!profileFile.eof()) {
+		throw runtime_error("Cannot parse knot " + to_string(times.size() + 1) + " in " + filename + ".");
+	}
+
+	return RateProfile(times, rates, interpolation);
+}
+
+
+RateProfileArrivalStream::RateProfileArrivalStream(
+	const PoissonSampler& sampler, const RateProfile& rateProfile, unsigned long long numberArrivals, unsigned int numberThreads) :
+	unitArrivals(sampler, 1, numberArrivals, numberThreads),
+	profile(rateProfile),
+	threads(numberThreads) {}
+
+
+const vector<double>& RateProfileArrivalStream::next() {
+	chunk = unitArrivals.next();
+	profile.transformUnitArrivalTimes(chunk.data(), chunk.size(), threads);
+
+	return chunk;
+}
+
+
+unsigned long long RateProfileArrivalStream::remaining() const {
+	return unitArrivals.remaining();
+}
+
+
+vector<double> sampleRateProfileArrivalTimes(
+	const RateProfile& profile, unsigned long numberArrivals, unsigned long seed, unsigned int threads,
+	RandomEngineType engineType) {
+	// Return numberArrivals arrival times of the Poisson process with the given rate profile. If seed is 0, sample
+	// new seed from random_device.
+
+	if (seed == 0) {
+		seed = random_device()();
+	}
+
+	PoissonSampler sampler(seed, engineType);
+	vector<double> arrivalTimes(numberArrivals);
+	fillPoissonProcessArrivalTimes(sampler, 1, arrivalTimes.data(), arrivalTimes.size(), 0, 0, threads);
+	profile.transformUnitArrivalTimes(arrivalTimes.data(), arrivalTimes.size(), threads);
+
+	return arrivalTimes;
+}
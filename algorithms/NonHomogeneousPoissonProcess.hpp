@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PoissonProcess.hpp"
+
+using std::vector;
+
+// How the arrival rate varies between the knots of a RateProfile.
+// constant: the rate of knot i holds from its time up to the next knot.
+// linear:   the rate is interpolated linearly between neighbouring knots.
+enum class RateInterpolation { constant, linear };
+
+bool parseRateInterpolation(const std::string& name, RateInterpolation& interpolation);
+
+// Arrival rate L(t) given by knots (t_i, L_i), repeated with period t_n - t_0 so that, for example, one day of knots
+// describes every day. The cumulative intensity C(t), the integral of L from t_0 to t, is tabulated at the knots, so
+// C and its inverse take a binary search for the segment and a closed form within it.
+class RateProfile {
+public:
+	RateProfile(const vector<double>& times, const vector<double>& rates, RateInterpolation interpolation);
+
+	double rate(double time) const;
+	double cumulativeIntensity(double time) const;
+	double inverseCumulativeIntensity(double intensity) const;
+
+	// Replace each value by its image under the inverse of C. Arrival times of a rate 1 Poisson process starting at 0
+	// become arrival times of the process with this profile starting at t_0.
+	void transformUnitArrivalTimes(double* times, size_t count, unsigned int threads = 1) const;
+
+	double period() const;
+	double periodIntensity() const;
+
+private:
+	size_t segmentAt(double time) const;
+
+	vector<double> knotTimes;
+	vector<double> knotRates;
+	vector<double> knotIntensities;
+	RateInterpolation interpolation;
+};
+
+RateProfile loadRateProfile(const std::string& filename, RateInterpolation interpolation);
+
+// Produces arrival times of the non-homogeneous process a chunk at a time, by transforming the arrival times
+// PoissonArrivalStream draws for rate 1 from the same sampler. Every draw yields an arrival, unlike thinning,
+// and the result does not depend on the number of threads. The profile must outlive the stream.
+class RateProfileArrivalStream {
+public:
+	RateProfileArrivalStream(
+		const PoissonSampler& sampler, const RateProfile& profile, unsigned long long numberArrivals, unsigned int threads = 1);
+
+	// Return the next chunk of arrival times, empty once all arrivals have been produced. The chunk is
+	// overwritten by the following call.
+	const vector<double>& next();
+	unsigned long long remaining() const;
+
+private:
+	PoissonArrivalStream unitArrivals;
+	const RateProfile& profile;
+	unsigned int threads;
+	vector<double> chunk;
+};
+
+vector<double> sampleRateProfileArrivalTimes(
+	const RateProfile& profile, unsigned long numberArrivals, unsigned long seed, unsigned int threads = 1,
+	RandomEngineType engineType = RandomEngineType::mt19937);
@@ -0,0 +1,475 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MatrixAllocator.hpp"
+#include "MatrixBinary.hpp"
+#include "MatrixMultiply.hpp"
+#include "Parallel.hpp"
+#include "PositionalFile.hpp"
+
+// Out-of-core operations on binary matrix files, for matrices too large for memory. A matrix on disk is treated as
+// a grid of tiles that are streamed through a fixed memory budget: while one tile is computed on, an I/O thread
+// writes back the previous result and reads the next tile, so the CPU and the disk are both kept busy and memory
+// use does not depend on the size of the matrices. Every operation reads binary matrix files, as written by
+// saveMatrixBinary or "matrix convert", and writes one. The output must be a different file from every input, and is
+// written under a temporary name that replaces it only once the operation has succeeded.
+
+
+// Thread running submitted jobs one at a time, in the order submitted. The returned future reports when the job is
+// done, and rethrows anything it threw. The destructor waits for the jobs already submitted.
+class IoThread {
+public:
+	IoThread() :
+		stopping(false),
+		worker([this]() { run(); }) {}
+
+	~IoThread() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		changed.notify_one();
+		worker.join();
+	}
+
+	IoThread(const IoThread&) = delete;
+	IoThread& operator=(const IoThread&) = delete;
+
+	std::future<void> submit(std::function<void()> job) {
+		std::packaged_task<void()> task(std::move(job));
+		std::future<void> done = task.get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(task));
+		}
+		changed.notify_one();
+		return done;
+	}
+
+private:
+	void run() {
+		for (;;) {
+			std::packaged_task<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (jobs.empty()) {
+					return;
+				}
+				task = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<std::packaged_task<void()>> jobs;
+	bool stopping;
+	std::thread worker;
+};
+
+
+// Binary matrix file whose tiles are read and written with positional I/O, so only the tiles in use are in memory.
+// A tile whose rows are whole rows of the matrix is one contiguous transfer, and any other one transfer per row.
+template<class elementType>
+class TiledMatrixFile {
+public:
+	// Open an existing file, read-only or read-write. Throws std::runtime_error if it is not a binary matrix file of
+	// elementType elements.
+	explicit TiledMatrixFile(const std::string& filename, PositionalFile::Mode mode = PositionalFile::Mode::read) :
+		file(filename, mode),
+		header(readMatrixFileHeader(file)) {
+		if (header.elementType != static_cast<uint32_t>(MatrixElementTypeOf<elementType>::value)) {
+			throw std::runtime_error(filename + " holds " +
+				matrixElementTypeName(static_cast<MatrixElementType>(header.elementType)) + " elements, not " +
+				matrixElementTypeName(MatrixElementTypeOf<elementType>::value) + ".");
+		}
+	}
+
+	// Create, or truncate, a file for a rows x cols matrix of zeros.
+	TiledMatrixFile(const std::string& filename, unsigned long rows, unsigned long cols) :
+		header(makeMatrixFileHeader(MatrixElementTypeOf<elementType>::value, rows, cols)) {
+		file = PositionalFile(filename, PositionalFile::Mode::create, matrixFileSize(header));
+		file.write(0, &header, sizeof(header));
+	}
+
+	void close() {
+		file.close();
+	}
+
+	unsigned long nRows() const {
+		return static_cast<unsigned long>(header.nRows);
+	}
+
+	unsigned long nCols() const {
+		return static_cast<unsigned long>(header.nCols);
+	}
+
+	// Read the rows x cols tile whose top left element is (firstRow, firstCol) into tile, whose rows are ld apart.
+	void readTile(unsigned long firstRow, unsigned long firstCol, unsigned long rows, unsigned long cols,
+		elementType* tile, size_t ld) const {
+		checkTile(firstRow, firstCol, rows, cols);
+		if (cols == header.nCols && ld == cols) {
+			file.read(offset(firstRow, 0), tile, static_cast<size_t>(rows) * cols * sizeof(elementType));
+			return;
+		}
+		for (unsigned long row = 0; row < rows; row++) {
+			file.read(offset(firstRow + row, firstCol), tile + row * ld, cols * sizeof(elementType));
+		}
+	}
+
+	void writeTile(unsigned long firstRow, unsigned long firstCol, unsigned long rows, unsigned long cols,
+		const elementType* tile, size_t ld) {
+		checkTile(firstRow, firstCol, rows, cols);
+		if (cols == header.nCols && ld == cols) {
+			file.write(offset(firstRow, 0), tile, static_cast<size_t>(rows) * cols * sizeof(elementType));
+			return;
+		}
+		for (unsigned long row = 0; row < rows; row++) {
+			file.write(offset(firstRow + row, firstCol), tile + row * ld, cols * sizeof(elementType));
+		}
+	}
+
+private:
+	uint64_t offset(unsigned long row, unsigned long col) const {
+		return header.dataOffset + (static_cast<uint64_t>(row) * header.nCols + col) * sizeof(elementType);
+	}
+
+	void checkTile(unsigned long firstRow, unsigned long firstCol, unsigned long rows, unsigned long cols) const {
+		if (firstRow + static_cast<uint64_t>(rows) > header.nRows || firstCol + static_cast<uint64_t>(cols) > header.nCols) {
+			throw std::runtime_error("Tile outside the " + std::to_string(header.nRows) + "x" +
+				std::to_string(header.nCols) + " matrix in " + file.filename() + ".");
+		}
+	}
+
+	PositionalFile file;
+	MatrixFileHeader header;
+};
+
+
+// Number of elements of elementType in memoryBudget bytes shared equally between buffers buffers. Throws
+// std::runtime_error if that leaves no room.
+template<class elementType>
+size_t outOfCoreBufferSize(size_t memoryBudget, size_t buffers) {
+	size_t elements = memoryBudget / buffers / sizeof(elementType);
+	if (elements == 0) {
+		throw std::runtime_error("A memory budget of " + std::to_string(memoryBudget) + " bytes is too small.");
+	}
+	return elements;
+}
+
+
+template<class elementType, class Compute>
+void streamMatrixTiles(const TiledMatrixFile<elementType>& input, TiledMatrixFile<elementType>& output,
+	unsigned long tileRows, unsigned long tileCols, bool transposeTiles, const Compute& compute) {
+	// For each tileRows x tileCols tile of input, call compute(in, out, rows, cols) to turn it into the tile of output
+	// at the same position, or when transposeTiles at the transposed position. Tiles are read into and written from
+	// two pairs of buffers in turn, so while one tile is computed the I/O thread writes the last and reads the next.
+
+	struct Tile {
+		unsigned long row;
+		unsigned long col;
+		unsigned long rows;
+		unsigned long cols;
+	};
+	std::vector<Tile> tiles;
+	for (unsigned long row = 0; row < input.nRows(); row += tileRows) {
+		for (unsigned long col = 0; col < input.nCols(); col += tileCols) {
+			tiles.push_back(Tile{ row, col, std::min(tileRows, input.nRows() - row), std::min(tileCols, input.nCols() - col) });
+		}
+	}
+	if (tiles.empty()) {
+		return;
+	}
+
+	// The I/O thread is declared after the buffers, so it finishes any transfer still queued before they are freed.
+	size_t capacity = static_cast<size_t>(tileRows) * tileCols;
+	MatrixStorage<elementType> in[2] = { MatrixStorage<elementType>(capacity), MatrixStorage<elementType>(capacity) };
+	MatrixStorage<elementType> out[2] = { MatrixStorage<elementType>(capacity), MatrixStorage<elementType>(capacity) };
+	IoThread io;
+	std::future<void> reads[2], writes[2];
+
+	auto read = [&](size_t index) {
+		Tile tile = tiles[index];
+		elementType* buffer = in[index % 2].data();
+		return io.submit([&input, tile, buffer]() {
+			input.readTile(tile.row, tile.col, tile.rows, tile.cols, buffer, tile.cols);
+		});
+	};
+
+	reads[0] = read(0);
+	for (size_t index = 0; index < tiles.size(); index++) {
+		size_t slot = index % 2;
+		Tile tile = tiles[index];
+		reads[slot].get();
+		if (index + 1 < tiles.size()) {
+			reads[1 - slot] = read(index + 1);
+		}
+		if (writes[slot].valid()) {
+			writes[slot].get();
+		}
+
+		compute(in[slot].data(), out[slot].data(), tile.rows, tile.cols);
+
+		elementType* buffer = out[slot].data();
+		writes[slot] = io.submit([&output, tile, buffer, transposeTiles]() {
+			if (transposeTiles) {
+				output.writeTile(tile.col, tile.row, tile.cols, tile.rows, buffer, tile.rows);
+			}
+			else {
+				output.writeTile(tile.row, tile.col, tile.rows, tile.cols, buffer, tile.cols);
+			}
+		});
+	}
+	for (auto& write : writes) {
+		if (write.valid()) {
+			write.get();
+		}
+	}
+}
+
+
+// Name under which an operation writes its output, replacing the output file on commit(). Construction throws
+// std::runtime_error if the output is the same file as one of the inputs. Without a commit, as when the operation
+// throws, the partial file is removed and any earlier output file is left as it was.
+class PartialMatrixFile {
+public:
+	PartialMatrixFile(const std::string& outputFilename, const std::vector<std::string>& inputFilenames) :
+		output(outputFilename),
+		partial(outputFilename + ".partial"),
+		committed(false) {
+		checkOutputFile(outputFilename, inputFilenames);
+	}
+
+	PartialMatrixFile(const PartialMatrixFile&) = delete;
+	PartialMatrixFile& operator=(const PartialMatrixFile&) = delete;
+
+	~PartialMatrixFile() {
+		if (!committed) {
+			std::remove(partial.c_str());
+		}
+	}
+
+	const std::string& filename() const {
+		return partial;
+	}
+
+	// Replace the output with the partial file, which must have been closed.
+	void commit() {
+		replaceFile(partial, output);
+		committed = true;
+	}
+
+private:
+	std::string output;
+	std::string partial;
+	bool committed;
+};
+
+
+// Write the transpose of the matrix in inputFilename to outputFilename, using at most about memoryBudget bytes.
+template<class elementType>
+void transposeMatrixFile(
+	const std::string& inputFilename, const std::string& outputFilename, size_t memoryBudget, unsigned int threads = 0) {
+	PartialMatrixFile partial(outputFilename, { inputFilename });
+	TiledMatrixFile<elementType> input(inputFilename);
+	TiledMatrixFile<elementType> output(partial.filename(), input.nCols(), input.nRows());
+
+	// Square tiles, so reads and writes alike are runs of the same length.
+	unsigned long side = static_cast<unsigned long>(std::sqrt(static_cast<double>(outOfCoreBufferSize<elementType>(memoryBudget, 4))));
+	side = std::max(1ul, side);
+	streamMatrixTiles(input, output, side, side, true, [threads](const elementType* in, elementType* out, unsigned long rows, unsigned long cols) {
+		// 32 x 32 blocks, so both the rows read and the rows written stay in cache.
+		const unsigned long block = 32;
+		parallelFor((cols + block - 1) / block, threads, [&](size_t firstBlock, size_t lastBlock) {
+			for (unsigned long col0 = static_cast<unsigned long>(firstBlock * block); col0 < std::min<size_t>(cols, lastBlock * block); col0 += block) {
+				for (unsigned long row0 = 0; row0 < rows; row0 += block) {
+					for (unsigned long col = col0; col < std::min(cols, col0 + block); col++) {
+						for (unsigned long row = row0; row < std::min(rows, row0 + block); row++) {
+							out[static_cast<size_t>(col) * rows + row] = in[static_cast<size_t>(row) * cols + col];
+						}
+					}
+				}
+			}
+		});
+	});
+	output.close();
+	partial.commit();
+}
+
+
+// Write function(x) for each element x of the matrix in inputFilename to outputFilename, using at most about
+// memoryBudget bytes.
+template<class elementType, class Function>
+void mapMatrixFile(const std::string& inputFilename, const std::string& outputFilename, const Function& function,
+	size_t memoryBudget, unsigned int threads = 0) {
+	PartialMatrixFile partial(outputFilename, { inputFilename });
+	TiledMatrixFile<elementType> input(inputFilename);
+	TiledMatrixFile<elementType> output(partial.filename(), input.nRows(), input.nCols());
+
+	// Whole rows where they fit, so each tile is one contiguous transfer.
+	size_t capacity = outOfCoreBufferSize<elementType>(memoryBudget, 4);
+	unsigned long tileCols = static_cast<unsigned long>(std::max<size_t>(1, std::min<size_t>(input.nCols(), capacity)));
+	unsigned long tileRows = static_cast<unsigned long>(std::max<size_t>(1, capacity / tileCols));
+	streamMatrixTiles(input, output, tileRows, tileCols, false,
+		[&function, threads](const elementType* in, elementType* out, unsigned long rows, unsigned long cols) {
+		parallelFor(static_cast<size_t>(rows) * cols, threads, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				out[i] = function(in[i]);
+			}
+		});
+	});
+	output.close();
+	partial.commit();
+}
+
+
+// Write op(A) * op(B) to cFilename for the matrices in aFilename and bFilename, using at most about memoryBudget
+// bytes. Throws std::runtime_error when the inner dimensions differ.
+template<class elementType>
+void multiplyMatrixFiles(const std::string& aFilename, const std::string& bFilename, const std::string& cFilename,
+	Transpose transposeA, Transpose transposeB, size_t memoryBudget, unsigned int threads = 0) {
+	// C is computed one mb x nb tile at a time in memory, summing the products of the mb x kb tiles of op(A) along its
+	// row and the kb x nb tiles of op(B) down its column with gemm. The tiles of op(A) and op(B) for the next product
+	// are read while gemm works on the current ones, and each finished C tile is written while the next is computed,
+	// so two of each buffer are needed. A is read once per column of C tiles and B once per row of them, which the
+	// largest tiles that fit keep to a minimum.
+
+	PartialMatrixFile partial(cFilename, { aFilename, bFilename });
+	TiledMatrixFile<elementType> a(aFilename);
+	TiledMatrixFile<elementType> b(bFilename);
+	unsigned long m = transposeA == Transpose::yes ? a.nCols() : a.nRows();
+	unsigned long k = transposeA == Transpose::yes ? a.nRows() : a.nCols();
+	unsigned long bRows = transposeB == Transpose::yes ? b.nCols() : b.nRows();
+	unsigned long n = transposeB == Transpose::yes ? b.nRows() : b.nCols();
+	if (k != bRows) {
+		throw std::runtime_error("Cannot multiply a " + std::to_string(m) + "x" + std::to_string(k) + " matrix by a " +
+			std::to_string(bRows) + "x" + std::to_string(n) + " matrix.");
+	}
+
+	// The file starts as zeros, which is the whole product when k is 0.
+	TiledMatrixFile<elementType> c(partial.filename(), m, n);
+	if (m == 0 || n == 0 || k == 0) {
+		c.close();
+		partial.commit();
+		return;
+	}
+
+	// Square tiles of side s take 6 s^2 elements. When n or k is smaller than s the C and op(A) tiles grow taller
+	// to use the rest of the budget.
+	size_t budget = outOfCoreBufferSize<elementType>(memoryBudget, 1);
+	size_t side = static_cast<size_t>(std::sqrt(budget / 6.0));
+	if (side >= 192) {
+		side -= side % 48;
+	}
+	if (side == 0) {
+		throw std::runtime_error("A memory budget of " + std::to_string(memoryBudget) + " bytes is too small.");
+	}
+	unsigned long kb = static_cast<unsigned long>(std::min<size_t>(k, side));
+	unsigned long nb = static_cast<unsigned long>(std::min<size_t>(n, side));
+	unsigned long mb = static_cast<unsigned long>(std::min<size_t>(m,
+		std::max(side, (budget - 2 * static_cast<size_t>(kb) * nb) / (2 * (static_cast<size_t>(nb) + kb)))));
+
+	struct Step {
+		unsigned long row;
+		unsigned long col;
+		unsigned long inner;
+		unsigned long rows;
+		unsigned long cols;
+		unsigned long depth;
+	};
+	std::vector<Step> steps;
+	for (unsigned long row = 0; row < m; row += mb) {
+		for (unsigned long col = 0; col < n; col += nb) {
+			for (unsigned long inner = 0; inner < k; inner += kb) {
+				steps.push_back(Step{ row, col, inner, std::min(mb, m - row), std::min(nb, n - col), std::min(kb, k - inner) });
+			}
+		}
+	}
+
+	// The I/O thread is declared after the buffers, so it finishes any transfer still queued before they are freed.
+	MatrixStorage<elementType> aTiles[2] = {
+		MatrixStorage<elementType>(static_cast<size_t>(mb) * kb), MatrixStorage<elementType>(static_cast<size_t>(mb) * kb) };
+	MatrixStorage<elementType> bTiles[2] = {
+		MatrixStorage<elementType>(static_cast<size_t>(kb) * nb), MatrixStorage<elementType>(static_cast<size_t>(kb) * nb) };
+	MatrixStorage<elementType> cTiles[2] = {
+		MatrixStorage<elementType>(static_cast<size_t>(mb) * nb), MatrixStorage<elementType>(static_cast<size_t>(mb) * nb) };
+	IoThread io;
+	std::future<void> reads[2], writes[2];
+
+	// A tile of op(A) is read as stored, so a transposed one is held depth x rows and passed to gemm as a transpose.
+	auto read = [&](size_t index) {
+		Step step = steps[index];
+		elementType* aTile = aTiles[index % 2].data();
+		elementType* bTile = bTiles[index % 2].data();
+		return io.submit([&a, &b, step, aTile, bTile, transposeA, transposeB]() {
+			if (transposeA == Transpose::yes) {
+				a.readTile(step.inner, step.row, step.depth, step.rows, aTile, step.rows);
+			}
+			else {
+				a.readTile(step.row, step.inner, step.rows, step.depth, aTile, step.depth);
+			}
+			if (transposeB == Transpose::yes) {
+				b.readTile(step.col, step.inner, step.cols, step.depth, bTile, step.depth);
+			}
+			else {
+				b.readTile(step.inner, step.col, step.depth, step.cols, bTile, step.cols);
+			}
+		});
+	};
+
+	reads[0] = read(0);
+	size_t cSlot = 1;
+	for (size_t index = 0; index < steps.size(); index++) {
+		size_t slot = index % 2;
+		Step step = steps[index];
+		reads[slot].get();
+		if (index + 1 < steps.size()) {
+			reads[1 - slot] = read(index + 1);
+		}
+
+		bool first = step.inner == 0;
+		bool last = step.inner + step.depth == k;
+		if (first) {
+			cSlot = 1 - cSlot;
+			if (writes[cSlot].valid()) {
+				writes[cSlot].get();
+			}
+		}
+
+		elementType* cTile = cTiles[cSlot].data();
+		gemm(transposeA, transposeB, step.rows, step.cols, step.depth,
+			elementType(1), aTiles[slot].data(), transposeA == Transpose::yes ? step.rows : step.depth,
+			bTiles[slot].data(), transposeB == Transpose::yes ? step.depth : step.cols,
+			first ? elementType(0) : elementType(1), cTile, step.cols, threads);
+
+		if (last) {
+			writes[cSlot] = io.submit([&c, step, cTile]() {
+				c.writeTile(step.row, step.col, step.rows, step.cols, cTile, step.cols);
+			});
+		}
+	}
+	for (auto& write : writes) {
+		if (write.valid()) {
+			write.get();
+		}
+	}
+	c.close();
+	partial.commit();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+inline unsigned int resolveThreadCount(unsigned int threads) {
+	// Return the number of threads to use, where 0 requests one per hardware thread.
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	return threads;
+}
+
+
+template<class Body>
+void parallelFor(size_t count, unsigned int threads, const Body& body) {
+	// Split [0, count) into one contiguous range per thread and call body(begin, end) on each, returning once all
+	// ranges are done. With a single thread or range the body runs on the calling thread.
+
+	threads = static_cast<unsigned int>(std::min<size_t>(resolveThreadCount(threads), count));
+	if (threads <= 1) {
+		if (count > 0) {
+			body(static_cast<size_t>(0), count);
+		}
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	for (unsigned int t = 0; t < threads; t++) {
+		size_t begin = count * t / threads;
+		size_t end = count * (t + 1) / threads;
+		workers.emplace_back([&body, begin, end]() { body(begin, end); });
+	}
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
@@ -0,0 +1,266 @@
+#include "PoissonCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "PoissonProcess.hpp"
+
+using namespace std;
+
+static const char tableMagic[8] = { 'P', 'P', 'C', 'A', 'C', 'H', 'E', '\0' };
+static const uint32_t tableVersion = 1;
+static const uint64_t initialTableCapacity = 4096;
+
+// On-disk layout: a 64-byte header followed by capacity entries. An entry with quantity 0 is empty.
+struct TableHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t quantizationBits;
+	uint64_t capacity;
+	uint64_t entries;
+	uint64_t reserved[4];
+};
+
+struct TableEntry {
+	uint64_t rateBits;
+	uint64_t durationBits;
+	uint64_t number;
+	uint32_t quantity;
+	uint32_t reserved;
+	double value;
+};
+
+
+static uint64_t quantize(double x) {
+	// Round x to quantizationBits mantissa bits and return its bit pattern. A carry out of the mantissa correctly
+	// moves to the next binade.
+	const unsigned int droppedBits = 52 - PoissonEvaluationCache::quantizationBits;
+	uint64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	bits = (bits + (uint64_t(1) << (droppedBits - 1))) & ~((uint64_t(1) << droppedBits) - 1);
+	return bits;
+}
+
+
+static double fromBits(uint64_t bits) {
+	double x;
+	memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+
+
+static uint64_t mixBits(uint64_t x) {
+	// SplitMix64 finalizer.
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+
+bool PoissonEvaluationCache::Key::operator==(const Key& other) const {
+	return rateBits == other.rateBits && durationBits == other.durationBits &&
+		number == other.number && quantity == other.quantity;
+}
+
+
+size_t PoissonEvaluationCache::KeyHash::operator()(const Key& key) const {
+	uint64_t hash = mixBits(key.rateBits);
+	hash = mixBits(hash ^ key.durationBits);
+	hash = mixBits(hash ^ key.number ^ (uint64_t(key.quantity) << 62));
+	return static_cast<size_t>(hash);
+}
+
+
+PoissonEvaluationCache::PoissonEvaluationCache(size_t capacity, const string& filename) :
+	memoryCapacity(capacity),
+	tableFilename(filename),
+	counters{ 0, 0, 0 } {
+	if (!tableFilename.empty()) {
+		openTable();
+	}
+}
+
+
+double PoissonEvaluationCache::pmf(double arrivalRate, double intervalDuration, unsigned long numberArrivals) {
+	return lookup(PoissonQuantity::pmf, arrivalRate, intervalDuration, numberArrivals);
+}
+
+
+double PoissonEvaluationCache::cdf(double arrivalRate, double intervalDuration, unsigned long numberArrivals) {
+	return lookup(PoissonQuantity::cdf, arrivalRate, intervalDuration, numberArrivals);
+}
+
+
+const PoissonCacheStatistics& PoissonEvaluationCache::statistics() const {
+	return counters;
+}
+
+
+double PoissonEvaluationCache::lookup(
+	PoissonQuantity quantity, double arrivalRate, double intervalDuration, unsigned long numberArrivals) {
+	Key key{ quantize(arrivalRate), quantize(intervalDuration), numberArrivals, static_cast<uint32_t>(quantity) };
+
+	auto found = recentIndex.find(key);
+	if (found != recentIndex.end()) {
+		recent.splice(recent.begin(), recent, found->second);
+		counters.memoryHits++;
+		return found->second->second;
+	}
+
+	double value;
+	if (findOnDisk(key, value)) {
+		counters.diskHits++;
+		remember(key, value);
+		return value;
+	}
+
+	counters.misses++;
+	double rate = fromBits(key.rateBits);
+	double duration = fromBits(key.durationBits);
+	value = quantity == PoissonQuantity::pmf ?
+		evalPoissonProcessIntervalPMF(rate, duration, numberArrivals) :
+		evalPoissonProcessIntervalCDF(rate, duration, numberArrivals);
+	remember(key, value);
+	storeOnDisk(key, value);
+
+	return value;
+}
+
+
+void PoissonEvaluationCache::remember(const Key& key, double value) {
+	if (memoryCapacity == 0) {
+		return;
+	}
+
+	if (recent.size() == memoryCapacity) {
+		recentIndex.erase(recent.back().first);
+		recent.pop_back();
+	}
+	recent.emplace_front(key, value);
+	recentIndex[key] = recent.begin();
+}
+
+
+bool PoissonEvaluationCache::findOnDisk(const Key& key, double& value) const {
+	if (table.data() == nullptr) {
+		return false;
+	}
+
+	const TableHeader* header = reinterpret_cast<const TableHeader*>(table.data());
+	const TableEntry* entries = reinterpret_cast<const TableEntry*>(table.data() + sizeof(TableHeader));
+	uint64_t mask = header->capacity - 1;
+
+	// Linear probing up to the first empty slot.
+	for (uint64_t slot = KeyHash()(key) & mask; entries[slot].quantity != 0; slot = (slot + 1) & mask) {
+		const TableEntry& entry = entries[slot];
+		if (entry.quantity == key.quantity && entry.number == key.number &&
+			entry.rateBits == key.rateBits && entry.durationBits == key.durationBits) {
+			value = entry.value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void PoissonEvaluationCache::storeOnDisk(const Key& key, double value) {
+	if (table.data() == nullptr) {
+		return;
+	}
+
+	TableHeader* header = reinterpret_cast<TableHeader*>(table.data());
+	if (2 * (header->entries + 1) > header->capacity) {
+		growTable();
+		header = reinterpret_cast<TableHeader*>(table.data());
+	}
+
+	TableEntry* entries = reinterpret_cast<TableEntry*>(table.data() + sizeof(TableHeader));
+	uint64_t mask = header->capacity - 1;
+	uint64_t slot = KeyHash()(key) & mask;
+	while (entries[slot].quantity != 0) {
+		slot = (slot + 1) & mask;
+	}
+
+	// Write the quantity last, so an interrupted write leaves the slot empty.
+	entries[slot].rateBits = key.rateBits;
+	entries[slot].durationBits = key.durationBits;
+	entries[slot].number = key.number;
+	entries[slot].value = value;
+	entries[slot].quantity = key.quantity;
+	header->entries++;
+}
+
+
+static void initializeTable(MappedFile& table, uint64_t capacity) {
+	// A file created by MappedFile is zero filled, so only the header needs writing.
+	TableHeader* header = reinterpret_cast<TableHeader*>(table.data());
+	memcpy(header->magic, tableMagic, sizeof(tableMagic));
+	header->version = tableVersion;
+	header->quantizationBits = PoissonEvaluationCache::quantizationBits;
+	header->capacity = capacity;
+	header->entries = 0;
+}
+
+
+void PoissonEvaluationCache::openTable() {
+	if (!ifstream(tableFilename)) {
+		table = MappedFile(tableFilename, MappedFile::Mode::create,
+			sizeof(TableHeader) + initialTableCapacity * sizeof(TableEntry));
+		initializeTable(table, initialTableCapacity);
+		return;
+	}
+
+	table = MappedFile(tableFilename, MappedFile::Mode::readWrite);
+	const TableHeader* header = reinterpret_cast<const TableHeader*>(table.data());
+	if (table.size() < sizeof(TableHeader) || memcmp(header->magic, tableMagic, sizeof(tableMagic)) != 0) {
+		table.close();
+		throw runtime_error(tableFilename + " is not a PMF/CDF cache.");
+	}
+	if (header->version != tableVersion || header->quantizationBits != quantizationBits ||
+		header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+		table.size() != sizeof(TableHeader) + header->capacity * sizeof(TableEntry)) {
+		table.close();
+		throw runtime_error(tableFilename + " was written by an incompatible version.");
+	}
+}
+
+
+void PoissonEvaluationCache::growTable() {
+	// Rehash into a table of twice the capacity in a temporary file, then replace the old file with it.
+	const TableHeader* header = reinterpret_cast<const TableHeader*>(table.data());
+	const TableEntry* entries = reinterpret_cast<const TableEntry*>(table.data() + sizeof(TableHeader));
+	uint64_t capacity = 2 * header->capacity;
+	string grownFilename = tableFilename + ".tmp";
+
+	MappedFile grown(grownFilename, MappedFile::Mode::create, sizeof(TableHeader) + capacity * sizeof(TableEntry));
+	initializeTable(grown, capacity);
+	TableHeader* grownHeader = reinterpret_cast<TableHeader*>(grown.data());
+	TableEntry* grownEntries = reinterpret_cast<TableEntry*>(grown.data() + sizeof(TableHeader));
+	uint64_t mask = capacity - 1;
+
+	for (uint64_t i = 0; i < header->capacity; i++) {
+		const TableEntry& entry = entries[i];
+		if (entry.quantity == 0) {
+			continue;
+		}
+
+		Key key{ entry.rateBits, entry.durationBits, entry.number, entry.quantity };
+		uint64_t slot = KeyHash()(key) & mask;
+		while (grownEntries[slot].quantity != 0) {
+			slot = (slot + 1) & mask;
+		}
+		grownEntries[slot] = entry;
+		grownHeader->entries++;
+	}
+
+	grown.close();
+	table.close();
+	remove(tableFilename.c_str());
+	if (rename(grownFilename.c_str(), tableFilename.c_str()) != 0) {
+		throw runtime_error("Cannot replace " + tableFilename + ".");
+	}
+	table = MappedFile(tableFilename, MappedFile::Mode::readWrite);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "MappedFile.hpp"
+
+enum class PoissonQuantity : uint32_t { pmf = 1, cdf = 2 };
+
+struct PoissonCacheStatistics {
+	unsigned long long memoryHits;
+	unsigned long long diskHits;
+	unsigned long long misses;
+};
+
+// Memoization of evalPoissonProcessIntervalPMF and evalPoissonProcessIntervalCDF. Rate and duration are rounded to
+// quantizationBits mantissa bits (relative spacing about 1e-12) to form the key, and values are evaluated at the
+// rounded parameters, so a cached value depends only on its key.
+// Lookups go to an in-process LRU of memoryCapacity entries first, then, when a filename is given, to an
+// open-addressing hash table in that file, memory mapped so that repeated runs find earlier values through the
+// page cache. The file is created if missing and doubled in size when half full. It must not be written by two
+// processes at once.
+class PoissonEvaluationCache {
+public:
+	explicit PoissonEvaluationCache(size_t memoryCapacity = 4096, const std::string& filename = "");
+
+	double pmf(double arrivalRate, double intervalDuration, unsigned long numberArrivals);
+	double cdf(double arrivalRate, double intervalDuration, unsigned long numberArrivals);
+	const PoissonCacheStatistics& statistics() const;
+
+	static const unsigned int quantizationBits = 40;
+
+private:
+	struct Key {
+		uint64_t rateBits;
+		uint64_t durationBits;
+		uint64_t number;
+		uint32_t quantity;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	double lookup(PoissonQuantity quantity, double arrivalRate, double intervalDuration, unsigned long numberArrivals);
+	void remember(const Key& key, double value);
+	bool findOnDisk(const Key& key, double& value) const;
+	void storeOnDisk(const Key& key, double value);
+	void openTable();
+	void growTable();
+
+	size_t memoryCapacity;
+	std::list<std::pair<Key, double>> recent;
+	std::unordered_map<Key, std::list<std::pair<Key, double>>::iterator, KeyHash> recentIndex;
+	std::string tableFilename;
+	MappedFile table;
+	PoissonCacheStatistics counters;
+};
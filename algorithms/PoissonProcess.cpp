@@ -3,11 +3,97 @@
 #include <iostream>
 #include <vector>
 #include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "Logging.hpp"
+#include "Parallel.hpp"
 
 using namespace std;
 
+static const double logSqrtTwoPi = 0.918938533204672741780329736406; // log(sqrt(2*pi))
+
+
+static double stirlingError(double n) {
+	// Return log(n!) - log(sqrt(2*pi*n) * (n/e)**n), the error of Stirling's approximation to n!.
+	// For small n use lgamma directly; for larger n the asymptotic series converges quickly and avoids
+	// the cancellation of subtracting two large, nearly equal numbers.
+
+	const double S0 = 1.0 / 12;
+	const double S1 = 1.0 / 360;
+	const double S2 = 1.0 / 1260;
+	const double S3 = 1.0 / 1680;
+	const double S4 = 1.0 / 1188;
+
+	if (n <= 15) {
+		return lgamma(n + 1) - (n + 0.5) * log(n) + n - logSqrtTwoPi;
+	}
+
+	double nn = n * n;
+	if (n > 500) return (S0 - S1 / nn) / n;
+	if (n > 80) return (S0 - (S1 - S2 / nn) / nn) / n;
+	if (n > 35) return (S0 - (S1 - (S2 - S3 / nn) / nn) / nn) / n;
+	return (S0 - (S1 - (S2 - (S3 - S4 / nn) / nn) / nn) / nn) / n;
+}
+
+
+static double binomialDeviance(double x, double m) {
+	// Return x*log(x/m) + m - x, the deviance term of the Poisson log density, without cancellation when x ~ m.
+
+	if (fabs(x - m) < 0.1 * (x + m)) {
+		double v = (x - m) / (x + m);
+		double sum = (x - m) * v;
+		double term = 2 * x * v;
+		v = v * v;
+		for (int j = 1; ; j++) {
+			term *= v;
+			double nextSum = sum + term / (2 * j + 1);
+			if (nextSum == sum) {
+				return nextSum;
+			}
+			sum = nextSum;
+		}
+	}
+
+	return x * log(x / m) + m - x;
+}
+
+
+static double evalPoissonLogDensity(double x, double m) {
+	// Return log(exp(-m) * m**x / x!) for real x >= 0 using Loader's saddle point expansion, which costs O(1)
+	// and keeps full relative precision for large x and m where lgamma(x+1) and x*log(m) nearly cancel.
+	// m := mean
+
+	if (m == 0) {
+		return x == 0 ? 0 : -numeric_limits<double>::infinity();
+	}
+	if (x == 0) {
+		return -m;
+	}
+
+	return -stirlingError(x) - binomialDeviance(x, m) - logSqrtTwoPi - 0.5 * log(x);
+}
+
+
+double evalPoissonProcessIntervalLogPMF(double arrivalRate, double intervalDuration, unsigned long numberArrivals) {
+	// Compute log P(N(t+s)-N(t) = k) = -L*s + k*log(L*s) - log(k!) in O(1).
+	// L := arrivalRate
+	// s := intervalDuration
+	// k := numberArrivals
+
+	double poissonMean = arrivalRate * intervalDuration;
+
+	return evalPoissonLogDensity(numberArrivals, poissonMean);
+}
+
+
 double evalPoissonProcessIntervalPMF(double arrivalRate, double intervalDuration, unsigned long numberArrivals) {
 	// Compute Poisson PMF P(N(t+s)-N(t) = k) = exp(-L*s) * (L*s)**k / k! 
 	// L := arrivalRate
@@ -22,105 +108,990 @@ double evalPoissonProcessIntervalPMF(double arrivalRate, double intervalDuration
 		<< endl;
 	)
 
-		double poissonMean = arrivalRate * intervalDuration;
-	double exponentialFactor = exp(-poissonMean);
+	// Evaluate in log space, as exp(-L*s) underflows for means above ~745 while the probability itself need not.
+	double probability = exp(evalPoissonProcessIntervalLogPMF(arrivalRate, intervalDuration, numberArrivals));
+
+	return probability;
+}
+
 
-	// Compute poissonMean**numberArrivals / numberArrivals! as a running product
-	// as both numerator and denominator are possible huge.
-	double runningProduct = 1;
-	for (unsigned long i = 1; i <= numberArrivals; i++) {
-		runningProduct *= poissonMean / i;
+double evalRegularizedUpperIncompleteGamma(double a, double x) {
+	// Return Q(a, x) = Gamma(a, x) / Gamma(a) for a > 0, x >= 0.
+	// Both branches scale by x**a * exp(-x) / Gamma(a+1), which is the Poisson density at a with mean x and is
+	// computed without underflow by evalPoissonLogDensity.
+
+	if (x <= 0) {
+		return 1;
 	}
 
-	double probability = exponentialFactor * runningProduct;
+	const double epsilon = numeric_limits<double>::epsilon();
+	double logScale = evalPoissonLogDensity(a, x);
 
-	return probability;
+	if (x < a + 1) {
+		// Series P(a, x) = scale * sum_{n>=0} x**n / ((a+1)...(a+n)), then Q = 1 - P.
+		double term = 1;
+		double sum = 1;
+		for (double n = 1; ; n++) {
+			term *= x / (a + n);
+			sum += term;
+			if (term < sum * epsilon) {
+				break;
+			}
+		}
+		return 1 - exp(logScale) * sum;
+	}
+
+	// Continued fraction Q(a, x) = a * scale / (x + 1 - a - 1*(1-a) / (x + 3 - a - ...)), evaluated with
+	// the modified Lentz method.
+	const double tiny = numeric_limits<double>::min() / epsilon;
+	double b = x + 1 - a;
+	double c = 1 / tiny;
+	double d = 1 / b;
+	double h = d;
+	for (double n = 1; ; n++) {
+		double an = -n * (n - a);
+		b += 2;
+		d = an * d + b;
+		if (fabs(d) < tiny) d = tiny;
+		c = b + an / c;
+		if (fabs(c) < tiny) c = tiny;
+		d = 1 / d;
+		double delta = d * c;
+		h *= delta;
+		if (fabs(delta - 1) < epsilon) {
+			break;
+		}
+	}
+
+	return a * exp(logScale) * h;
 }
 
 
-vector<double> samplePoissonProcessArrivalTimes(double arrivalRate, unsigned long numberArrivals, unsigned long seed = 0) {
-	// Sample n arrival times from Poisson process with arrival rate L. If seed is 0, sample new seed from random_device.
-	// n := numberArrivals
+double evalPoissonProcessIntervalCDF(double arrivalRate, double intervalDuration, unsigned long numberArrivals) {
+	// Compute Poisson CDF P(N(t+s)-N(t) <= k) = Q(k+1, L*s), the regularized upper incomplete gamma function.
+	// L := arrivalRate
+	// s := intervalDuration
+	// k := numberArrivals
+
+	double poissonMean = arrivalRate * intervalDuration;
+
+	return evalRegularizedUpperIncompleteGamma(numberArrivals + 1.0, poissonMean);
+}
+
+
+static double evalStandardNormalQuantile(double p) {
+	// Return z with Phi(z) = p for 0 < p < 1, by Acklam's rational approximation (relative error 1.2e-9)
+	// followed by one Halley step on erfc, which brings it to full double precision.
+
+	const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+		1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+	const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+		6.680131188771972e+01, -1.328068155288572e+01 };
+	const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+		-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+	const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+		3.754408661907416e+00 };
+	const double lowerBreak = 0.02425;
+
+	double z;
+	if (p < lowerBreak) {
+		double q = sqrt(-2 * log(p));
+		z = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+			((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+	}
+	else if (p <= 1 - lowerBreak) {
+		double q = p - 0.5;
+		double r = q * q;
+		z = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+			(((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+	}
+	else {
+		double q = sqrt(-2 * log(1 - p));
+		z = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+			((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+	}
+
+	double error = 0.5 * erfc(-z / sqrt(2.0)) - p;
+	double u = error * sqrt(2 * 3.14159265358979323846) * exp(z * z / 2);
+	z = z - u / (1 + z * u / 2);
+
+	return z;
+}
+
+
+unsigned long evalPoissonProcessIntervalQuantile(double arrivalRate, double intervalDuration, double probability) {
+	// Return the smallest k with P(N(t+s)-N(t) <= k) >= p.
 	// L := arrivalRate
+	// s := intervalDuration
+	// p := probability
+	//
+	// Start from the Cornish-Fisher expansion k ~ m + sqrt(m) * (z + (z*z - 1) / (6 * sqrt(m))) of the normal
+	// approximation, with m = L*s and z the standard normal quantile of p, which is within a few units of the
+	// answer. Evaluate the CDF there once, then step down or up with the PMF recurrences.
 
-	static random_device seedGen;
-	static unsigned long activeSeed = seed;
-	if (seed == 0) {
-		activeSeed = seedGen();
+	double poissonMean = arrivalRate * intervalDuration;
+	if (probability <= 0 || poissonMean <= 0) {
+		return 0;
+	}
+	if (probability >= 1) {
+		return numeric_limits<unsigned long>::max();
 	}
-	LOG_DEBUG(
-		cout << "DEBUG: seed " << seed << " activeSeed " << activeSeed << endl;
-	)
 
-		vector<double> arrivalTimes(numberArrivals);
-	double latestArrivalTime = 0;
+	// Allow for rounding in the CDF, so a probability equal to CDF(k) returns k and not k + 1.
+	double target = probability * (1 - 64 * numeric_limits<double>::epsilon());
 
-	// Sample exponential inter-arrival times and accumulate to determine arrival times.
-	for (unsigned long i = 0; i < numberArrivals; i++) {
-		double interArrivalTime = sampleExponential(arrivalRate, activeSeed);
-		latestArrivalTime += interArrivalTime;
-		arrivalTimes[i] = latestArrivalTime;
+	double sigma = sqrt(poissonMean);
+	double z = evalStandardNormalQuantile(probability);
+	double guess = floor(poissonMean + sigma * (z + (z * z - 1) / (6 * sigma)) + 0.5);
+	unsigned long k = static_cast<unsigned long>(max(0.0, guess));
+
+	double cumulativeProbability = evalPoissonProcessIntervalCDF(arrivalRate, intervalDuration, k);
+	double pointProbability = evalPoissonProcessIntervalPMF(arrivalRate, intervalDuration, k);
+
+	if (cumulativeProbability >= target) {
+		// CDF(k-1) = CDF(k) - P(k) and P(k-1) = P(k) * k / m.
+		while (k > 0 && cumulativeProbability - pointProbability >= target) {
+			cumulativeProbability -= pointProbability;
+			pointProbability *= k / poissonMean;
+			k--;
+		}
+	}
+	else {
+		// P(k+1) = P(k) * m / (k+1) and CDF(k+1) = CDF(k) + P(k+1).
+		while (cumulativeProbability < target) {
+			k++;
+			pointProbability *= poissonMean / k;
+			cumulativeProbability += pointProbability;
+		}
 	}
 
-	return arrivalTimes;
+	return k;
 }
 
 
-unsigned long samplePoissonProcessNumberArrivals(double arrivalRate, double intervalDuration, unsigned long seed = 0) {
-	// Return random variate of N(t+s) - N(t) from a Poisson process N with arrival rate L.
+vector<unsigned long> evalPoissonProcessIntervalQuantiles(double arrivalRate, double intervalDuration, const vector<double>& probabilities) {
+	// Return the quantile of each probability, in the order given.
+
+	vector<unsigned long> quantiles(probabilities.size());
+	for (size_t i = 0; i < probabilities.size(); i++) {
+		quantiles[i] = evalPoissonProcessIntervalQuantile(arrivalRate, intervalDuration, probabilities[i]);
+	}
+
+	return quantiles;
+}
+
+
+PoissonDistributionTable evalPoissonProcessIntervalTable(double arrivalRate, double intervalDuration, unsigned long numberArrivals) {
+	// Compute P(N(t+s)-N(t) = i) and P(N(t+s)-N(t) <= i) for i = 0..k in a single pass using the recurrences
+	// P(i+1) = P(i) * L*s / (i+1) and P(i-1) = P(i) * i / (L*s), then accumulate the CDF.
+	// L := arrivalRate
 	// s := intervalDuration
+	// k := numberArrivals
+
+	double poissonMean = arrivalRate * intervalDuration;
+
+	PoissonDistributionTable table;
+	table.pmf.resize(static_cast<size_t>(numberArrivals) + 1);
+	table.cdf.resize(static_cast<size_t>(numberArrivals) + 1);
+
+	// Start the recurrence from the mode (or k if smaller) so it begins at the largest probability, which does
+	// not underflow even when P(0) = exp(-L*s) does.
+	unsigned long start = static_cast<unsigned long>(min(floor(poissonMean), static_cast<double>(numberArrivals)));
+	table.pmf[start] = evalPoissonProcessIntervalPMF(arrivalRate, intervalDuration, start);
+	for (unsigned long i = start; i > 0; i--) {
+		table.pmf[i - 1] = table.pmf[i] * i / poissonMean;
+	}
+	for (unsigned long i = start; i < numberArrivals; i++) {
+		table.pmf[i + 1] = table.pmf[i] * poissonMean / (i + 1);
+	}
+
+	double cumulativeProbability = 0;
+	for (unsigned long i = 0; i <= numberArrivals; i++) {
+		cumulativeProbability += table.pmf[i];
+		table.cdf[i] = cumulativeProbability;
+	}
+
+	return table;
+}
+
+
+// Bulk exponential sampling.
+//
+// Exponential variates are produced by inversion, -log(u) / L, with u = 2 - d and d a double in [1, 2) built from
+// the top 52 bits of a generator word, so u lies in (0, 1] and is exact. log(u) uses the Cephes rational
+// approximation, evaluated with the same operations in the AVX2 and scalar paths so both give identical bits.
+// Arrival times are accumulated four at a time with an in-register prefix sum, again mirrored by the scalar path.
+
+static const size_t bulkBufferSize = 256;
+
+static const double logSqrtHalf = 0.70710678118654752440;
+static const double logC1 = 0.693359375;
+static const double logC2 = -2.121944400546905827679e-4;
+static const double logP[] = {
+	1.01875663804580931796E-4, 4.97494994976747001425E-1, 4.70579119878881725854E0,
+	1.44989225341610930846E1, 1.79368678507819816313E1, 7.70838733755885391666E0 };
+static const double logQ[] = {
+	1.12873587189167450590E1, 4.52279145837532221105E1, 8.29875266912776603211E1,
+	7.11544750618563894466E1, 2.31251620126765340583E1 };
+
+
+static inline double exponentialFromBits(uint64_t bits, double arrivalRate) {
+	uint64_t unitBits = (bits >> 12) | 0x3FF0000000000000ULL;
+	double unit;
+	memcpy(&unit, &unitBits, sizeof(unit));
+	double u = 2 - unit;
+
+	// Split u = m * 2**e with m in [0.5, 1).
+	uint64_t uBits;
+	memcpy(&uBits, &u, sizeof(u));
+	double e = static_cast<double>((uBits >> 52) & 0x7FF) - 1022;
+	uint64_t mBits = (uBits & 0x000FFFFFFFFFFFFFULL) | 0x3FE0000000000000ULL;
+	double m;
+	memcpy(&m, &mBits, sizeof(m));
+
+	double x;
+	if (m < logSqrtHalf) {
+		e = e - 1;
+		x = (m + m) - 1;
+	}
+	else {
+		x = m - 1;
+	}
+
+	double z = x * x;
+	double p = ((((logP[0] * x + logP[1]) * x + logP[2]) * x + logP[3]) * x + logP[4]) * x + logP[5];
+	double q = ((((x + logQ[0]) * x + logQ[1]) * x + logQ[2]) * x + logQ[3]) * x + logQ[4];
+	double y = x * (z * p / q);
+	y = y + e * logC2;
+	y = y - 0.5 * z;
+	double logU = x + y;
+	logU = logU + e * logC1;
+
+	return -logU / arrivalRate;
+}
+
+
+static inline void accumulateQuad(const double* interArrivalTimes, double& latestArrivalTime, double* arrivalTimes, size_t count) {
+	// Scalar mirror of the AVX2 in-register prefix sum: lanes hold e0, e0+e1, (e1+e2)+e0, (e2+e3)+(e0+e1).
+	double e0 = interArrivalTimes[0], e1 = interArrivalTimes[1], e2 = interArrivalTimes[2], e3 = interArrivalTimes[3];
+	double prefix[4] = { e0, e0 + e1, (e1 + e2) + e0, (e2 + e3) + (e0 + e1) };
+	for (size_t lane = 0; lane < count; lane++) {
+		arrivalTimes[lane] = latestArrivalTime + prefix[lane];
+	}
+	latestArrivalTime = latestArrivalTime + prefix[3];
+}
+
+
+#ifdef __AVX2__
+static inline __m256d exponentialFromBits(__m256i bits, __m256d arrivalRate) {
+	const __m256d one = _mm256_set1_pd(1);
+	const __m256d two = _mm256_set1_pd(2);
+	const __m256d half = _mm256_set1_pd(0.5);
+
+	__m256d unit = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 12), _mm256_set1_epi64x(0x3FF0000000000000LL)));
+	__m256d u = _mm256_sub_pd(two, unit);
+
+	// Split u = m * 2**e with m in [0.5, 1). The 11 bit exponent field is converted to double by placing it in
+	// the mantissa of 2**52 and subtracting 2**52.
+	__m256i uBits = _mm256_castpd_si256(u);
+	const __m256d twoPow52 = _mm256_set1_pd(4503599627370496.0);
+	__m256d e = _mm256_sub_pd(
+		_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(uBits, 52), _mm256_castpd_si256(twoPow52))),
+		twoPow52);
+	e = _mm256_sub_pd(e, _mm256_set1_pd(1022));
+	__m256d m = _mm256_castsi256_pd(_mm256_or_si256(
+		_mm256_and_si256(uBits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+		_mm256_set1_epi64x(0x3FE0000000000000LL)));
+
+	__m256d below = _mm256_cmp_pd(m, _mm256_set1_pd(logSqrtHalf), _CMP_LT_OQ);
+	e = _mm256_blendv_pd(e, _mm256_sub_pd(e, one), below);
+	__m256d x = _mm256_blendv_pd(_mm256_sub_pd(m, one), _mm256_sub_pd(_mm256_add_pd(m, m), one), below);
+
+	__m256d z = _mm256_mul_pd(x, x);
+	__m256d p = _mm256_set1_pd(logP[0]);
+	for (int i = 1; i < 6; i++) {
+		p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(logP[i]));
+	}
+	__m256d q = _mm256_add_pd(x, _mm256_set1_pd(logQ[0]));
+	for (int i = 1; i < 5; i++) {
+		q = _mm256_add_pd(_mm256_mul_pd(q, x), _mm256_set1_pd(logQ[i]));
+	}
+	__m256d y = _mm256_mul_pd(x, _mm256_div_pd(_mm256_mul_pd(z, p), q));
+	y = _mm256_add_pd(y, _mm256_mul_pd(e, _mm256_set1_pd(logC2)));
+	y = _mm256_sub_pd(y, _mm256_mul_pd(half, z));
+	__m256d logU = _mm256_add_pd(x, y);
+	logU = _mm256_add_pd(logU, _mm256_mul_pd(e, _mm256_set1_pd(logC1)));
+
+	return _mm256_div_pd(_mm256_sub_pd(_mm256_setzero_pd(), logU), arrivalRate);
+}
+#endif
+
+
+static void transformExponential(const uint64_t* bits, size_t count, double arrivalRate, double* interArrivalTimes) {
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256d rate = _mm256_set1_pd(arrivalRate);
+	for (; i + 4 <= count; i += 4) {
+		__m256i quadBits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + i));
+		_mm256_storeu_pd(interArrivalTimes + i, exponentialFromBits(quadBits, rate));
+	}
+#endif
+	for (; i < count; i++) {
+		interArrivalTimes[i] = exponentialFromBits(bits[i], arrivalRate);
+	}
+}
+
+
+static void transformArrivalTimes(const uint64_t* bits, size_t count, double arrivalRate, double& latestArrivalTime, double* arrivalTimes) {
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256d rate = _mm256_set1_pd(arrivalRate);
+	__m256d zero = _mm256_setzero_pd();
+	__m256d carry = _mm256_set1_pd(latestArrivalTime);
+	for (; i + 4 <= count; i += 4) {
+		__m256i quadBits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + i));
+		__m256d interArrival = exponentialFromBits(quadBits, rate);
+
+		// Prefix sum across the four lanes by adding copies shifted up by one and then two lanes.
+		__m256d shifted = _mm256_blend_pd(_mm256_permute4x64_pd(interArrival, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x1);
+		__m256d prefix = _mm256_add_pd(interArrival, shifted);
+		shifted = _mm256_blend_pd(_mm256_permute4x64_pd(prefix, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x3);
+		prefix = _mm256_add_pd(prefix, shifted);
+
+		__m256d arrival = _mm256_add_pd(carry, prefix);
+		_mm256_storeu_pd(arrivalTimes + i, arrival);
+		carry = _mm256_permute4x64_pd(arrival, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	latestArrivalTime = _mm256_cvtsd_f64(carry);
+#endif
+	for (; i < count; i += 4) {
+		size_t lanes = min<size_t>(4, count - i);
+		double interArrival[4] = { 0, 0, 0, 0 };
+		for (size_t lane = 0; lane < lanes; lane++) {
+			interArrival[lane] = exponentialFromBits(bits[i + lane], arrivalRate);
+		}
+		accumulateQuad(interArrival, latestArrivalTime, arrivalTimes + i, lanes);
+	}
+}
+
+
+void PoissonSampler::fillExponential(double arrivalRate, double* interArrivalTimes, size_t count) {
+	// Fill the buffer with n exponential variates with rate L.
+	// n := count
 	// L := arrivalRate
 
-	static random_device seedGen;
-	static unsigned long activeSeed = seed;
-	if (seed == 0) {
-		activeSeed = seedGen();
+	uint64_t bits[bulkBufferSize];
+	for (size_t offset = 0; offset < count; offset += bulkBufferSize) {
+		size_t chunk = min(bulkBufferSize, count - offset);
+		drawWords(bits, chunk);
+		transformExponential(bits, chunk, arrivalRate, interArrivalTimes + offset);
 	}
-	LOG_DEBUG(
-		cout << "DEBUG: seed " << seed << " activeSeed " << activeSeed << endl;
-	);
+}
 
-	double meanNumberArrivals = arrivalRate * intervalDuration;
 
-	return samplePoisson(meanNumberArrivals, activeSeed);
+double PoissonSampler::fillArrivalTimes(double arrivalRate, double* arrivalTimes, size_t count, double startTime) {
+	// Fill the buffer with the next n arrival times after startTime of a Poisson process with rate L, summing the
+	// inter-arrival times in the same pass. Returns the last arrival time, or startTime if n is 0.
+	// n := count
+	// L := arrivalRate
+
+	uint64_t bits[bulkBufferSize];
+	double latestArrivalTime = startTime;
+	for (size_t offset = 0; offset < count; offset += bulkBufferSize) {
+		size_t chunk = min(bulkBufferSize, count - offset);
+		drawWords(bits, chunk);
+		transformArrivalTimes(bits, chunk, arrivalRate, latestArrivalTime, arrivalTimes + offset);
+	}
+
+	return latestArrivalTime;
 }
 
 
+PoissonVariateGenerator::PoissonVariateGenerator(double mean) :
+	poissonMean(mean),
+	b(0), a(0), inverseAlpha(0), vr(0) {
+	if (mean < smallMeanThreshold) {
+		// Tabulate the CDF until it rounds to 1, which for means below 10 is under 50 entries, and a guide
+		// table whose entry g is the smallest k with CDF(k) > g / guideSize.
+		double probability = exp(-mean);
+		double cumulativeProbability = probability;
+		cdf.push_back(cumulativeProbability);
+		for (unsigned long k = 1; cumulativeProbability < 1 && probability > 0; k++) {
+			probability *= mean / k;
+			cumulativeProbability += probability;
+			cdf.push_back(cumulativeProbability);
+		}
+		cdf.back() = 1;
 
-double sampleExponential(double arrivalRate, unsigned long seed) {
+		size_t guideSize = cdf.size();
+		guide.resize(guideSize);
+		unsigned int k = 0;
+		for (size_t g = 0; g < guideSize; g++) {
+			while (cdf[k] <= static_cast<double>(g) / guideSize) {
+				k++;
+			}
+			guide[g] = k;
+		}
+		return;
+	}
+
+	// Constants of PTRS from W. Hormann, "The transformed rejection method for generating Poisson random
+	// variables", Insurance: Mathematics and Economics 12 (1993).
+	double sqrtMean = sqrt(mean);
+	b = 0.931 + 2.53 * sqrtMean;
+	a = -0.059 + 0.02483 * b;
+	inverseAlpha = 1.1239 + 1.1328 / (b - 3.4);
+	vr = 0.9277 - 3.6224 / (b - 2);
+}
+
+
+double PoissonVariateGenerator::mean() const {
+	return poissonMean;
+}
+
+
+unsigned long PoissonVariateGenerator::sample(PoissonSampler& sampler) const {
+	if (poissonMean <= 0) {
+		return 0;
+	}
+
+	return cdf.empty() ? sampleRejection(sampler) : sampleInversion(sampler);
+}
+
+
+unsigned long PoissonVariateGenerator::sampleInversion(PoissonSampler& sampler) const {
+	double u = sampler.sampleUniform();
+	unsigned int k = guide[static_cast<size_t>(u * guide.size())];
+	while (cdf[k] <= u) {
+		k++;
+	}
+
+	return k;
+}
+
+
+unsigned long PoissonVariateGenerator::sampleRejection(PoissonSampler& sampler) const {
+	while (true) {
+		double u = sampler.sampleUniform() - 0.5;
+		double v = sampler.sampleUniform();
+		double us = 0.5 - fabs(u);
+		double k = floor((2 * a / us + b) * u + poissonMean + 0.43);
+
+		// Squeeze: accept without evaluating the density.
+		if (us >= 0.07 && v <= vr) {
+			return static_cast<unsigned long>(k);
+		}
+		if (k < 0 || (us < 0.013 && v > us)) {
+			continue;
+		}
+		if (log(v * inverseAlpha / (a / (us * us) + b)) <= evalPoissonLogDensity(k, poissonMean)) {
+			return static_cast<unsigned long>(k);
+		}
+	}
+}
+
+
+PoissonSampler::PoissonSampler(unsigned long long seed, RandomEngineType type) :
+	PoissonSampler(seed, type, 0) {}
+
+
+PoissonSampler::PoissonSampler(unsigned long long seed, RandomEngineType type, unsigned long long stream) :
+	rootSeed(seed),
+	engineType(type),
+	generator(makeRandomEngine(type, seed, stream)),
+	nextBufferedWord(wordBufferSize) {}
+
+
+PoissonSampler::PoissonSampler(const PoissonSampler& other) :
+	rootSeed(other.rootSeed),
+	engineType(other.engineType),
+	generator(other.generator->clone()),
+	nextBufferedWord(other.nextBufferedWord),
+	variateGenerators(other.variateGenerators) {
+	copy(begin(other.wordBuffer), end(other.wordBuffer), begin(wordBuffer));
+}
+
+
+PoissonSampler& PoissonSampler::operator=(const PoissonSampler& other) {
+	if (this != &other) {
+		PoissonSampler copied(other);
+		*this = move(copied);
+	}
+
+	return *this;
+}
+
+
+PoissonSampler PoissonSampler::substream(unsigned long long index) const {
+	// Substream i is stream i + 1 of the engine for the root seed, which makeRandomEngine derives from (seed, i)
+	// alone, so substreams do not overlap in practice and depend only on the root seed.
+
+	return PoissonSampler(rootSeed, engineType, index + 1);
+}
+
+
+unsigned long long PoissonSampler::seed() const {
+	return rootSeed;
+}
+
+
+RandomEngineType PoissonSampler::engine() const {
+	return engineType;
+}
+
+
+uint64_t PoissonSampler::nextWord() {
+	// Scalar draws come from a small buffer, refilled a block at a time to keep the virtual call off the
+	// per-variate path.
+
+	if (nextBufferedWord == wordBufferSize) {
+		generator->fill(wordBuffer, wordBufferSize);
+		nextBufferedWord = 0;
+	}
+
+	return wordBuffer[nextBufferedWord++];
+}
+
+
+void PoissonSampler::drawWords(uint64_t* words, size_t count) {
+	// Hand out any buffered words first so bulk and scalar draws consume one sequence.
+
+	size_t buffered = min(count, wordBufferSize - nextBufferedWord);
+	copy(wordBuffer + nextBufferedWord, wordBuffer + nextBufferedWord + buffered, words);
+	nextBufferedWord += buffered;
+	if (count > buffered) {
+		generator->fill(words + buffered, count - buffered);
+	}
+}
+
+
+void PoissonSampler::discard(unsigned long long count) {
+	size_t buffered = static_cast<size_t>(min<unsigned long long>(count, wordBufferSize - nextBufferedWord));
+	nextBufferedWord += buffered;
+	if (count > buffered) {
+		generator->discard(count - buffered);
+	}
+}
+
+
+double PoissonSampler::sampleUniform() {
+	// Return uniform random variate on [0, 1) with 52 random bits.
+
+	uint64_t unitBits = (nextWord() >> 12) | 0x3FF0000000000000ULL;
+	double unit;
+	memcpy(&unit, &unitBits, sizeof(unit));
+
+	return unit - 1;
+}
+
+
+double PoissonSampler::sampleExponential(double arrivalRate) {
 	// Return exponential random variate with rate L.
 	// L := arrivalRate
 	// pdf: f(x) = L e**(-Lx)
 
-	static unsigned long currentSeed = 0;
-	static mt19937_64 gen(currentSeed);
+	return exponentialFromBits(nextWord(), arrivalRate);
+}
+
+
+unsigned long PoissonSampler::samplePoisson(double mean) {
+	// Return Poisson random variate with mean m.
+	// m := mean
+	// pmf: f(x) =  e**(-m) * m**x / x!
+
+	return cachedVariateGenerator(mean).sample(*this);
+}
+
+
+void PoissonSampler::fillPoisson(double mean, unsigned long* counts, size_t count) {
+	// Fill the buffer with n Poisson random variates with mean m.
+	// n := count
+	// m := mean
+
+	fillPoisson(cachedVariateGenerator(mean), counts, count);
+}
+
+
+void PoissonSampler::fillPoisson(const PoissonVariateGenerator& variates, unsigned long* counts, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		counts[i] = variates.sample(*this);
+	}
+}
+
+
+const PoissonVariateGenerator& PoissonSampler::cachedVariateGenerator(double mean) {
+	// Keep the setup of the generators for the means in use. The cache is cleared if a caller cycles through
+	// many different means, so it stays small.
+
+	const size_t maxCachedMeans = 64;
+
+	auto cached = variateGenerators.find(mean);
+	if (cached != variateGenerators.end()) {
+		return cached->second;
+	}
+
+	if (variateGenerators.size() >= maxCachedMeans) {
+		variateGenerators.clear();
+	}
+
+	return variateGenerators.emplace(mean, PoissonVariateGenerator(mean)).first->second;
+}
+
+
+vector<double> PoissonSampler::sampleArrivalTimes(double arrivalRate, unsigned long numberArrivals) {
+	// Sample n arrival times from Poisson process with arrival rate L.
+	// n := numberArrivals
+	// L := arrivalRate
+
+	vector<double> arrivalTimes(numberArrivals);
+	fillArrivalTimes(arrivalRate, arrivalTimes.data(), arrivalTimes.size());
+
+	return arrivalTimes;
+}
+
+
+unsigned long PoissonSampler::sampleNumberArrivals(double arrivalRate, double intervalDuration) {
+	// Return random variate of N(t+s) - N(t) from a Poisson process N with arrival rate L.
+	// s := intervalDuration
+	// L := arrivalRate
+
+	double meanNumberArrivals = arrivalRate * intervalDuration;
+
+	return samplePoisson(meanNumberArrivals);
+}
+
+
+static unsigned long resolveSeed(unsigned long seed) {
+	// If seed is 0, sample new seed from random_device.
+
+	if (seed != 0) {
+		return seed;
+	}
+
+	random_device seedGen;
+	return seedGen();
+}
+
+
+static PoissonSampler& threadSampler(unsigned long seed) {
+	// Return this thread's sampler for the free sampling functions, reseeding it when the seed changes.
+
+	thread_local unsigned long currentSeed = 0;
+	thread_local PoissonSampler sampler(currentSeed);
 
 	if (currentSeed != seed) {
 		currentSeed = seed;
-		gen.seed(currentSeed);
+		sampler = PoissonSampler(currentSeed);
 	}
 
-	exponential_distribution<double> dist(arrivalRate);
+	return sampler;
+}
+
 
-	return dist(gen);
+void fillPoissonProcessInterArrivalTimes(
+	const PoissonSampler& sampler, double arrivalRate, double* interArrivalTimes, size_t count, unsigned long long first) {
+	// Fill the buffer with inter-arrival times first..first+n-1 of the sequence fillPoissonProcessArrivalTimes
+	// generates from the sampler, whose arrival time i is the sum of inter-arrival times 0..i. Each block starts from
+	// the substream of its block, skipping to its offset in the block, which with a random access engine such as
+	// Philox costs O(n) whatever the value of first.
+	// n := count
+	// L := arrivalRate
+
+	size_t filled = 0;
+	while (filled < count) {
+		unsigned long long index = first + filled;
+		unsigned long long block = index / arrivalTimesBlockSize;
+		size_t offset = static_cast<size_t>(index % arrivalTimesBlockSize);
+		size_t blockCount = min(count - filled, arrivalTimesBlockSize - offset);
+
+		PoissonSampler stream = sampler.substream(block);
+		stream.discard(offset);
+		stream.fillExponential(arrivalRate, interArrivalTimes + filled, blockCount);
+		filled += blockCount;
+	}
+}
+
+
+double fillPoissonProcessArrivalTimes(
+	const PoissonSampler& sampler, double arrivalRate, double* arrivalTimes, size_t count,
+	unsigned long long firstBlock, double startTime, unsigned int threads) {
+	// Fill the buffer with n arrival times after startTime of a Poisson process with rate L, the i-th drawn from
+	// block firstBlock + i / arrivalTimesBlockSize. Returns the last arrival time, or startTime if n is 0.
+	// n := count
+	// L := arrivalRate
+	//
+	// 1. Each block draws its inter-arrival times from its own substream and sums them locally from 0.
+	// 2. The block totals are scanned in block order into the starting time of each block.
+	// 3. Each block adds its starting time to its local arrival times.
+	// Every addition happens in the same order whatever the thread count, so the output is bit-identical for a
+	// given seed. The scan in step 2 is over count / arrivalTimesBlockSize values and is done serially.
+
+	size_t numberBlocks = (count + arrivalTimesBlockSize - 1) / arrivalTimesBlockSize;
+	vector<double> blockStartTimes(numberBlocks);
+
+	parallelFor(numberBlocks, threads, [&](size_t beginBlock, size_t endBlock) {
+		for (size_t block = beginBlock; block < endBlock; block++) {
+			size_t offset = block * arrivalTimesBlockSize;
+			size_t blockSize = min(arrivalTimesBlockSize, count - offset);
+			PoissonSampler stream = sampler.substream(firstBlock + block);
+			blockStartTimes[block] = stream.fillArrivalTimes(arrivalRate, arrivalTimes + offset, blockSize);
+		}
+	});
+
+	double latestArrivalTime = startTime;
+	for (size_t block = 0; block < numberBlocks; block++) {
+		double blockTotal = blockStartTimes[block];
+		blockStartTimes[block] = latestArrivalTime;
+		latestArrivalTime += blockTotal;
+	}
+
+	parallelFor(numberBlocks, threads, [&](size_t beginBlock, size_t endBlock) {
+		for (size_t block = beginBlock; block < endBlock; block++) {
+			size_t offset = block * arrivalTimesBlockSize;
+			size_t blockSize = min(arrivalTimesBlockSize, count - offset);
+			double blockStartTime = blockStartTimes[block];
+			for (size_t i = offset; i < offset + blockSize; i++) {
+				arrivalTimes[i] += blockStartTime;
+			}
+		}
+	});
+
+	return latestArrivalTime;
+}
+
+
+vector<double> samplePoissonProcessArrivalTimes(
+	double arrivalRate, unsigned long numberArrivals, unsigned long seed, unsigned int threads, RandomEngineType engineType) {
+	// Sample n arrival times from Poisson process with arrival rate L using the given number of threads, where 0
+	// means one per hardware thread. If seed is 0, sample new seed from random_device.
+	// n := numberArrivals
+	// L := arrivalRate
+
+	unsigned long activeSeed = resolveSeed(seed);
+	LOG_DEBUG(
+		cout << "DEBUG: seed " << seed << " activeSeed " << activeSeed << endl;
+	)
+
+	PoissonSampler sampler(activeSeed, engineType);
+	vector<double> arrivalTimes(numberArrivals);
+	fillPoissonProcessArrivalTimes(sampler, arrivalRate, arrivalTimes.data(), arrivalTimes.size(), 0, 0, threads);
+
+	return arrivalTimes;
+}
+
+
+PoissonArrivalStream::PoissonArrivalStream(const PoissonSampler& arrivalSampler, double rate, unsigned long long numberArrivals, unsigned int numberThreads) :
+	sampler(arrivalSampler),
+	arrivalRate(rate),
+	remainingArrivals(numberArrivals),
+	nextBlock(0),
+	latestArrivalTime(0),
+	threads(resolveThreadCount(numberThreads)) {
+	// Generate a few blocks per thread per chunk, so chunks stay small but every thread has work.
+	chunk.reserve(4 * threads * arrivalTimesBlockSize);
+}
+
+
+const vector<double>& PoissonArrivalStream::next() {
+	size_t chunkSize = static_cast<size_t>(min<unsigned long long>(chunk.capacity(), remainingArrivals));
+	chunk.resize(chunkSize);
+
+	latestArrivalTime = fillPoissonProcessArrivalTimes(
+		sampler, arrivalRate, chunk.data(), chunk.size(), nextBlock, latestArrivalTime, threads);
+
+	nextBlock += (chunkSize + arrivalTimesBlockSize - 1) / arrivalTimesBlockSize;
+	remainingArrivals -= chunkSize;
+
+	return chunk;
+}
+
+
+unsigned long long PoissonArrivalStream::remaining() const {
+	return remainingArrivals;
+}
+
+
+unsigned long samplePoissonProcessNumberArrivals(
+	double arrivalRate, double intervalDuration, unsigned long seed, RandomEngineType engineType) {
+	// Return random variate of N(t+s) - N(t) from a Poisson process N with arrival rate L. If seed is 0, sample
+	// new seed from random_device.
+	// s := intervalDuration
+	// L := arrivalRate
+
+	unsigned long activeSeed = resolveSeed(seed);
+	LOG_DEBUG(
+		cout << "DEBUG: seed " << seed << " activeSeed " << activeSeed << endl;
+	);
+
+	PoissonSampler sampler(activeSeed, engineType);
+
+	return sampler.sampleNumberArrivals(arrivalRate, intervalDuration);
+}
+
+
+double sampleExponential(double arrivalRate, unsigned long seed) {
+	// Return exponential random variate with rate L from this thread's generator.
+	// L := arrivalRate
+
+	return threadSampler(seed).sampleExponential(arrivalRate);
 }
 
 
 unsigned long samplePoisson(double mean, unsigned long seed) {
-	// Return Poisson random variate with mean m.
+	// Return Poisson random variate with mean m from this thread's generator.
 	// m := mean
-	// pmf: f(x) =  e**(-m) * m**x / x!
 
-	static unsigned long currentSeed = 0;
-	static mt19937_64 gen(currentSeed);
+	return threadSampler(seed).samplePoisson(mean);
+}
 
-	if (currentSeed != seed) {
-		currentSeed = seed;
-		gen.seed(currentSeed);
+
+// Number of variates drawn from each substream by samplePoissonProcessNumberArrivalsSummary.
+static const size_t numberArrivalsBlockSize = 1 << 16;
+
+
+class CountHistogram {
+public:
+	CountHistogram() : minimum(0) {}
+
+	void add(unsigned long value) {
+		if (counts.empty()) {
+			minimum = value;
+		}
+		else if (value < minimum) {
+			counts.insert(counts.begin(), minimum - value, 0);
+			minimum = value;
+		}
+		if (value - minimum >= counts.size()) {
+			counts.resize(value - minimum + 1, 0);
+		}
+		counts[value - minimum]++;
 	}
 
-	poisson_distribution<unsigned long> dist(mean);
+	void merge(const CountHistogram& other) {
+		for (size_t i = 0; i < other.counts.size(); i++) {
+			if (other.counts[i] > 0) {
+				add(other.minimum + static_cast<unsigned long>(i), other.counts[i]);
+			}
+		}
+	}
 
-	return dist(gen);
-}
+	unsigned long minimum;
+	vector<unsigned long long> counts;
 
+private:
+	void add(unsigned long value, unsigned long long number) {
+		add(value);
+		counts[value - minimum] += number - 1;
+	}
+};
+
+
+PoissonSampleSummary samplePoissonProcessNumberArrivalsSummary(
+	double arrivalRate, double intervalDuration, unsigned long long count, unsigned long seed, unsigned int threads,
+	RandomEngineType engineType) {
+	// Draw n variates of N(t+s) - N(t) from a Poisson process N with arrival rate L, aggregate them into a histogram,
+	// and compare the histogram with the Poisson PMF. Each thread fills its own histogram from fixed-size blocks,
+	// block b drawing from substream b, and the histograms are merged at the end, so the result does not depend
+	// on the number of threads. If seed is 0, sample new seed from random_device.
+	// n := count
+	// s := intervalDuration
+	// L := arrivalRate
+
+	PoissonSampler sampler(resolveSeed(seed), engineType);
+	double meanNumberArrivals = arrivalRate * intervalDuration;
+	PoissonVariateGenerator variates(meanNumberArrivals);
+
+	unsigned long long numberBlocks = (count + numberArrivalsBlockSize - 1) / numberArrivalsBlockSize;
+	unsigned int numberThreads = static_cast<unsigned int>(min<unsigned long long>(resolveThreadCount(threads), max(numberBlocks, 1ULL)));
+	vector<CountHistogram> threadHistograms(numberThreads);
+
+	parallelFor(numberThreads, numberThreads, [&](size_t beginThread, size_t endThread) {
+		for (size_t thread = beginThread; thread < endThread; thread++) {
+			CountHistogram& histogram = threadHistograms[thread];
+			vector<unsigned long> numberArrivals(numberArrivalsBlockSize);
+			for (unsigned long long block = numberBlocks * thread / numberThreads; block < numberBlocks * (thread + 1) / numberThreads; block++) {
+				PoissonSampler stream = sampler.substream(block);
+				size_t blockSize = static_cast<size_t>(min<unsigned long long>(numberArrivalsBlockSize, count - block * numberArrivalsBlockSize));
+				stream.fillPoisson(variates, numberArrivals.data(), blockSize);
+				for (size_t i = 0; i < blockSize; i++) {
+					histogram.add(numberArrivals[i]);
+				}
+			}
+		}
+	});
+
+	CountHistogram histogram;
+	for (const CountHistogram& threadHistogram : threadHistograms) {
+		histogram.merge(threadHistogram);
+	}
+
+	PoissonSampleSummary summary;
+	summary.count = count;
+	summary.minimum = histogram.minimum;
+	summary.counts = histogram.counts;
+
+	// Moments about the sample mean.
+	double sum = 0;
+	for (size_t i = 0; i < histogram.counts.size(); i++) {
+		sum += static_cast<double>(histogram.minimum + i) * histogram.counts[i];
+	}
+	summary.mean = count > 0 ? sum / count : 0;
+
+	double secondMoment = 0, thirdMoment = 0, fourthMoment = 0;
+	for (size_t i = 0; i < histogram.counts.size(); i++) {
+		double deviation = static_cast<double>(histogram.minimum + i) - summary.mean;
+		double squaredDeviation = deviation * deviation;
+		secondMoment += squaredDeviation * histogram.counts[i];
+		thirdMoment += squaredDeviation * deviation * histogram.counts[i];
+		fourthMoment += squaredDeviation * squaredDeviation * histogram.counts[i];
+	}
+	if (count > 0) {
+		secondMoment /= count;
+		thirdMoment /= count;
+		fourthMoment /= count;
+	}
+	summary.variance = count > 1 ? secondMoment * count / (count - 1) : 0;
+	summary.skewness = secondMoment > 0 ? thirdMoment / pow(secondMoment, 1.5) : 0;
+	summary.excessKurtosis = secondMoment > 0 ? fourthMoment / (secondMoment * secondMoment) - 3 : 0;
+
+	// Pearson's chi-square test against the Poisson PMF, pooling values until each bin expects at least 5.
+	const double minimumExpected = 5;
+	vector<double> expectedBins, observedBins;
+	double expected = histogram.minimum > 0 ? count * evalPoissonProcessIntervalCDF(arrivalRate, intervalDuration, histogram.minimum - 1) : 0;
+	double observed = 0;
+	for (size_t i = 0; i < histogram.counts.size(); i++) {
+		unsigned long value = histogram.minimum + static_cast<unsigned long>(i);
+		expected += count * evalPoissonProcessIntervalPMF(arrivalRate, intervalDuration, value);
+		observed += histogram.counts[i];
+		if (expected >= minimumExpected) {
+			expectedBins.push_back(expected);
+			observedBins.push_back(observed);
+			expected = 0;
+			observed = 0;
+		}
+	}
+	if (!histogram.counts.empty()) {
+		unsigned long maximum = histogram.minimum + static_cast<unsigned long>(histogram.counts.size()) - 1;
+		expected += count * (1 - evalPoissonProcessIntervalCDF(arrivalRate, intervalDuration, maximum));
+	}
+	if (!expectedBins.empty() && expected < minimumExpected) {
+		expectedBins.back() += expected;
+		observedBins.back() += observed;
+	}
+	else if (expected > 0 || observed > 0) {
+		expectedBins.push_back(expected);
+		observedBins.push_back(observed);
+	}
+
+	summary.chiSquare = 0;
+	for (size_t bin = 0; bin < expectedBins.size(); bin++) {
+		double difference = observedBins[bin] - expectedBins[bin];
+		summary.chiSquare += difference * difference / expectedBins[bin];
+	}
+	summary.degreesOfFreedom = expectedBins.size() > 1 ? static_cast<unsigned long>(expectedBins.size() - 1) : 0;
+	summary.pValue = summary.degreesOfFreedom > 0
+		? evalRegularizedUpperIncompleteGamma(summary.degreesOfFreedom / 2.0, summary.chiSquare / 2)
+		: 1;
+
+	return summary;
+}
@@ -1,11 +1,154 @@
 #pragma once
 
 #include <vector>
+#include <random>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+
+#include "RandomEngine.hpp"
 
 using std::vector;
 
+// PMF and CDF of N(t+s) - N(t) for every number of arrivals 0..k, index i holding P(= i) and P(<= i).
+struct PoissonDistributionTable {
+	vector<double> pmf;
+	vector<double> cdf;
+};
+
 double evalPoissonProcessIntervalPMF(double arrivalRate, double intervalDuration, unsigned long numberArrivals);
-vector<double> samplePoissonProcessArrivalTimes(double arrivalRate, unsigned long numberArrivals, unsigned long seed);
-unsigned long samplePoissonProcessNumberArrivals(double arrivalRate, double intervalDuration, unsigned long seed);
+double evalPoissonProcessIntervalLogPMF(double arrivalRate, double intervalDuration, unsigned long numberArrivals);
+double evalPoissonProcessIntervalCDF(double arrivalRate, double intervalDuration, unsigned long numberArrivals);
+double evalRegularizedUpperIncompleteGamma(double a, double x);
+unsigned long evalPoissonProcessIntervalQuantile(double arrivalRate, double intervalDuration, double probability);
+vector<unsigned long> evalPoissonProcessIntervalQuantiles(double arrivalRate, double intervalDuration, const vector<double>& probabilities);
+PoissonDistributionTable evalPoissonProcessIntervalTable(double arrivalRate, double intervalDuration, unsigned long numberArrivals);
+
+class PoissonSampler;
+
+// Poisson variate generator for one fixed mean, with its setup done once at construction.
+// Means below smallMeanThreshold use inversion of a precomputed CDF table with a guide table, costing one uniform
+// and about one comparison per variate. Larger means use Hormann's transformed rejection with squeeze (PTRS),
+// which accepts about 90% of the time and costs O(1) independent of the mean.
+class PoissonVariateGenerator {
+public:
+	explicit PoissonVariateGenerator(double mean);
+
+	double mean() const;
+	unsigned long sample(PoissonSampler& sampler) const;
+
+	static constexpr double smallMeanThreshold = 10;
+
+private:
+	unsigned long sampleInversion(PoissonSampler& sampler) const;
+	unsigned long sampleRejection(PoissonSampler& sampler) const;
+
+	double poissonMean;
+	vector<double> cdf;
+	vector<unsigned int> guide;
+	double b, a, inverseAlpha, vr;
+};
+
+// Sampler owning its own generator state, so separate instances may be used concurrently from different threads.
+// substream(i) returns a sampler whose stream is determined by (seed, i) alone and is independent of the parent's,
+// giving one reproducible stream per worker.
+class PoissonSampler {
+public:
+	explicit PoissonSampler(unsigned long long seed, RandomEngineType engineType = RandomEngineType::mt19937);
+	PoissonSampler(const PoissonSampler& other);
+	PoissonSampler& operator=(const PoissonSampler& other);
+	PoissonSampler(PoissonSampler&& other) = default;
+	PoissonSampler& operator=(PoissonSampler&& other) = default;
+
+	PoissonSampler substream(unsigned long long index) const;
+	unsigned long long seed() const;
+	RandomEngineType engine() const;
+
+	// Skip the next count generator words. Each exponential variate uses exactly one word, so this skips
+	// count inter-arrival times, in O(1) for engines with random access.
+	void discard(unsigned long long count);
+
+	double sampleUniform();
+	double sampleExponential(double arrivalRate);
+	void fillExponential(double arrivalRate, double* interArrivalTimes, size_t count);
+	double fillArrivalTimes(double arrivalRate, double* arrivalTimes, size_t count, double startTime = 0);
+	unsigned long samplePoisson(double mean);
+	void fillPoisson(double mean, unsigned long* counts, size_t count);
+	void fillPoisson(const PoissonVariateGenerator& variates, unsigned long* counts, size_t count);
+	vector<double> sampleArrivalTimes(double arrivalRate, unsigned long numberArrivals);
+	unsigned long sampleNumberArrivals(double arrivalRate, double intervalDuration);
+
+private:
+	PoissonSampler(unsigned long long seed, RandomEngineType engineType, unsigned long long stream);
+
+	uint64_t nextWord();
+	void drawWords(uint64_t* words, size_t count);
+	const PoissonVariateGenerator& cachedVariateGenerator(double mean);
+
+	static const size_t wordBufferSize = 64;
+
+	unsigned long long rootSeed;
+	RandomEngineType engineType;
+	std::unique_ptr<RandomEngine> generator;
+	uint64_t wordBuffer[wordBufferSize];
+	size_t nextBufferedWord;
+	std::unordered_map<double, PoissonVariateGenerator> variateGenerators;
+};
+
+// Arrival times generated in parallel are split into blocks of this many arrivals, block b drawing from
+// substream b of the sampler so the result does not depend on how blocks are assigned to threads.
+const size_t arrivalTimesBlockSize = 1 << 16;
+
+void fillPoissonProcessInterArrivalTimes(
+	const PoissonSampler& sampler, double arrivalRate, double* interArrivalTimes, size_t count, unsigned long long first);
+double fillPoissonProcessArrivalTimes(
+	const PoissonSampler& sampler, double arrivalRate, double* arrivalTimes, size_t count,
+	unsigned long long firstBlock, double startTime, unsigned int threads);
+vector<double> samplePoissonProcessArrivalTimes(
+	double arrivalRate, unsigned long numberArrivals, unsigned long seed, unsigned int threads = 1,
+	RandomEngineType engineType = RandomEngineType::mt19937);
+
+// Produces the same arrival times as fillPoissonProcessArrivalTimes, a fixed number of blocks at a time, so any number
+// of arrivals can be generated in constant memory.
+class PoissonArrivalStream {
+public:
+	PoissonArrivalStream(const PoissonSampler& sampler, double arrivalRate, unsigned long long numberArrivals, unsigned int threads = 1);
+
+	// Return the next chunk of arrival times, empty once all arrivals have been produced. The chunk is
+	// overwritten by the following call.
+	const vector<double>& next();
+	unsigned long long remaining() const;
+
+private:
+	PoissonSampler sampler;
+	double arrivalRate;
+	unsigned long long remainingArrivals;
+	unsigned long long nextBlock;
+	double latestArrivalTime;
+	unsigned int threads;
+	vector<double> chunk;
+};
+unsigned long samplePoissonProcessNumberArrivals(
+	double arrivalRate, double intervalDuration, unsigned long seed, RandomEngineType engineType = RandomEngineType::mt19937);
+
+// Empirical distribution of many variates of N(t+s) - N(t) and its fit to the Poisson PMF. counts[i] holds the
+// number of variates equal to minimum + i. The chi-square statistic pools neighbouring values until each bin
+// expects at least 5 variates, with the tails below minimum and above the largest variate in the outer bins.
+struct PoissonSampleSummary {
+	unsigned long long count;
+	unsigned long minimum;
+	vector<unsigned long long> counts;
+	double mean;
+	double variance;
+	double skewness;
+	double excessKurtosis;
+	double chiSquare;
+	unsigned long degreesOfFreedom;
+	double pValue;
+};
+
+PoissonSampleSummary samplePoissonProcessNumberArrivalsSummary(
+	double arrivalRate, double intervalDuration, unsigned long long count, unsigned long seed, unsigned int threads = 1,
+	RandomEngineType engineType = RandomEngineType::mt19937);
 double sampleExponential(double arrivalRate, unsigned long seed);
 unsigned long samplePoisson(double mean, unsigned long seed);
@@ -0,0 +1,115 @@
+#include "PoissonSuperposition.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const size_t heapArity = 4;
+static const size_t unitExponentialBufferSize = 1024;
+
+
+PoissonSuperposition::PoissonSuperposition(const vector<double>& arrivalRates, const PoissonSampler& arrivalSampler) :
+	rates(arrivalRates),
+	sampler(arrivalSampler),
+	unitExponentials(unitExponentialBufferSize),
+	nextUnit(unitExponentialBufferSize) {
+	// Seed the heap with the first arrival of each source. Sources with rate 0 never arrive and are left out.
+	heap.reserve(rates.size());
+	for (unsigned long long source = 0; source < rates.size(); source++) {
+		if (rates[source] > 0) {
+			heap.push_back(PendingArrival{ nextUnitExponential() / rates[source], source });
+		}
+	}
+
+	for (size_t position = heap.size() / heapArity + 1; position-- > 0; ) {
+		siftDown(position);
+	}
+}
+
+
+double PoissonSuperposition::nextUnitExponential() {
+	// Draw rate 1 exponentials in bulk and scale by 1/L on use, as E/L is exponential with rate L.
+
+	if (nextUnit == unitExponentials.size()) {
+		sampler.fillExponential(1, unitExponentials.data(), unitExponentials.size());
+		nextUnit = 0;
+	}
+
+	return unitExponentials[nextUnit++];
+}
+
+
+void PoissonSuperposition::siftDown(size_t position) {
+	if (position >= heap.size()) {
+		return;
+	}
+
+	PendingArrival moving = heap[position];
+	while (true) {
+		size_t firstChild = heapArity * position + 1;
+		if (firstChild >= heap.size()) {
+			break;
+		}
+
+		size_t lastChild = min(firstChild + heapArity, heap.size());
+		size_t earliest = firstChild;
+		for (size_t child = firstChild + 1; child < lastChild; child++) {
+			if (heap[child].time < heap[earliest].time) {
+				earliest = child;
+			}
+		}
+		if (!(heap[earliest].time < moving.time)) {
+			break;
+		}
+
+		heap[position] = heap[earliest];
+		position = earliest;
+	}
+	heap[position] = moving;
+}
+
+
+void PoissonSuperposition::fill(double* arrivalTimes, unsigned long long* sources, size_t count) {
+	// Emit the earliest pending arrival, then replace it in place by that source's following arrival.
+
+	for (size_t i = 0; i < count; i++) {
+		PendingArrival& earliest = heap[0];
+		arrivalTimes[i] = earliest.time;
+		sources[i] = earliest.source;
+
+		earliest.time += nextUnitExponential() / rates[earliest.source];
+		siftDown(0);
+	}
+}
+
+
+bool PoissonSuperposition::empty() const {
+	return heap.empty();
+}
+
+
+vector<double> loadArrivalRates(const string& filename) {
+	// Read whitespace separated, non-negative arrival rates, one per source.
+
+	ifstream ratesFile(filename);
+	if (!ratesFile) {
+		throw runtime_error("Cannot open " + filename + ".");
+	}
+
+	vector<double> rates;
+	double rate;
+	while (ratesFile >> rate) {
+		if (rate < 0) {
+			throw runtime_error("Negative arrival rate in " + filename + ".");
+		}
+		rates.push_back(rate);
+	}
+	if (!ratesFile.eof()) {
+		throw runtime_error("Cannot parse arrival rate " + to_string(rates.size() + 1) + " in " + filename + ".");
+	}
+
+	return rates;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PoissonProcess.hpp"
+
+using std::vector;
+
+// Merges the arrivals of independent Poisson processes, one per source rate, into a single time-ordered stream of
+// (arrival time, source index) pairs. Only the next arrival of each source is held, in a 4-ary min-heap, so memory
+// is O(sources) and each arrival costs O(log sources) however many arrivals are drawn.
+class PoissonSuperposition {
+public:
+	PoissonSuperposition(const vector<double>& arrivalRates, const PoissonSampler& sampler);
+
+	// Fill the buffers with the next count arrivals in time order and the source index of each.
+	void fill(double* arrivalTimes, unsigned long long* sources, size_t count);
+	bool empty() const;
+
+private:
+	struct PendingArrival {
+		double time;
+		unsigned long long source;
+	};
+
+	void siftDown(size_t position);
+	double nextUnitExponential();
+
+	vector<double> rates;
+	vector<PendingArrival> heap;
+	PoissonSampler sampler;
+	vector<double> unitExponentials;
+	size_t nextUnit;
+};
+
+vector<double> loadArrivalRates(const std::string& filename);
@@ -0,0 +1,223 @@
+#include "PositionalFile.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Largest single read or write, below the 32-bit limit of ReadFile and WriteFile.
+static const size_t maximumTransfer = 1 << 30;
+
+PositionalFile::PositionalFile() :
+	length(0),
+#ifdef _WIN32
+	fileHandle(nullptr) {}
+#else
+	descriptor(-1) {}
+#endif
+
+
+PositionalFile::PositionalFile(const string& filename, Mode mode, uint64_t createSize) : PositionalFile() {
+	bool create = mode == Mode::create;
+	bool writable = mode != Mode::read;
+	name = filename;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		filename.c_str(),
+		writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		create ? CREATE_ALWAYS : OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw runtime_error("Cannot open " + filename + ".");
+	}
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (create) {
+		fileSize.QuadPart = static_cast<LONGLONG>(createSize);
+		if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+			close();
+			throw runtime_error("Cannot resize " + filename + ".");
+		}
+	}
+	else if (!GetFileSizeEx(file, &fileSize)) {
+		close();
+		throw runtime_error("Cannot read size of " + filename + ".");
+	}
+	length = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+	descriptor = create ? open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) :
+		open(filename.c_str(), writable ? O_RDWR : O_RDONLY);
+	if (descriptor < 0) {
+		throw runtime_error("Cannot open " + filename + ".");
+	}
+
+	if (create) {
+		if (ftruncate(descriptor, static_cast<off_t>(createSize)) != 0) {
+			close();
+			throw runtime_error("Cannot resize " + filename + ".");
+		}
+		length = createSize;
+	}
+	else {
+		struct stat fileStatus;
+		if (fstat(descriptor, &fileStatus) != 0) {
+			close();
+			throw runtime_error("Cannot read size of " + filename + ".");
+		}
+		length = static_cast<uint64_t>(fileStatus.st_size);
+	}
+#endif
+}
+
+
+PositionalFile::PositionalFile(PositionalFile&& other) noexcept : PositionalFile() {
+	*this = move(other);
+}
+
+
+PositionalFile& PositionalFile::operator=(PositionalFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		swap(name, other.name);
+		swap(length, other.length);
+#ifdef _WIN32
+		swap(fileHandle, other.fileHandle);
+#else
+		swap(descriptor, other.descriptor);
+#endif
+	}
+
+	return *this;
+}
+
+
+PositionalFile::~PositionalFile() {
+	close();
+}
+
+
+void PositionalFile::read(uint64_t offset, void* data, size_t size) const {
+	char* bytes = static_cast<char*>(data);
+	while (size > 0) {
+		size_t chunk = min(size, maximumTransfer);
+#ifdef _WIN32
+		OVERLAPPED position = {};
+		position.Offset = static_cast<DWORD>(offset);
+		position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD transferred = 0;
+		if (!ReadFile(fileHandle, bytes, static_cast<DWORD>(chunk), &transferred, &position) || transferred == 0) {
+			throw runtime_error("Cannot read " + name + ".");
+		}
+#else
+		ssize_t transferred = pread(descriptor, bytes, chunk, static_cast<off_t>(offset));
+		if (transferred < 0 && errno == EINTR) {
+			continue;
+		}
+		if (transferred <= 0) {
+			throw runtime_error("Cannot read " + name + ".");
+		}
+#endif
+		bytes += transferred;
+		offset += transferred;
+		size -= transferred;
+	}
+}
+
+
+void PositionalFile::write(uint64_t offset, const void* data, size_t size) {
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0) {
+		size_t chunk = min(size, maximumTransfer);
+#ifdef _WIN32
+		OVERLAPPED position = {};
+		position.Offset = static_cast<DWORD>(offset);
+		position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD transferred = 0;
+		if (!WriteFile(fileHandle, bytes, static_cast<DWORD>(chunk), &transferred, &position) || transferred == 0) {
+			throw runtime_error("Cannot write " + name + ".");
+		}
+#else
+		ssize_t transferred = pwrite(descriptor, bytes, chunk, static_cast<off_t>(offset));
+		if (transferred < 0 && errno == EINTR) {
+			continue;
+		}
+		if (transferred <= 0) {
+			throw runtime_error("Cannot write " + name + ".");
+		}
+#endif
+		bytes += transferred;
+		offset += transferred;
+		size -= transferred;
+	}
+}
+
+
+void PositionalFile::close() {
+#ifdef _WIN32
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+	}
+	fileHandle = nullptr;
+#else
+	if (descriptor >= 0) {
+		::close(descriptor);
+	}
+	descriptor = -1;
+#endif
+	length = 0;
+}
+
+
+bool isSameFile(const string& first, const string& second) {
+#ifdef _WIN32
+	// The volume and file index identify a file whatever path or link opened it.
+	auto identify = [](const string& filename, BY_HANDLE_FILE_INFORMATION& information) {
+		HANDLE file = CreateFileA(filename.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		bool identified = GetFileInformationByHandle(file, &information) != 0;
+		CloseHandle(file);
+		return identified;
+	};
+	BY_HANDLE_FILE_INFORMATION firstInformation, secondInformation;
+	return identify(first, firstInformation) && identify(second, secondInformation) &&
+		firstInformation.dwVolumeSerialNumber == secondInformation.dwVolumeSerialNumber &&
+		firstInformation.nFileIndexHigh == secondInformation.nFileIndexHigh &&
+		firstInformation.nFileIndexLow == secondInformation.nFileIndexLow;
+#else
+	struct stat firstStatus, secondStatus;
+	return stat(first.c_str(), &firstStatus) == 0 && stat(second.c_str(), &secondStatus) == 0 &&
+		firstStatus.st_dev == secondStatus.st_dev && firstStatus.st_ino == secondStatus.st_ino;
+#endif
+}
+
+
+void replaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+	bool replaced = MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool replaced = rename(from.c_str(), to.c_str()) == 0;
+#endif
+	if (!replaced) {
+		throw runtime_error("Cannot replace " + to + ".");
+	}
+}
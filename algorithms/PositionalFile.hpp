@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// File read and written at explicit offsets, for files too large to map or load whole, which are instead read and
+// written a piece at a time. No file position is shared between calls, so several threads may read and write
+// different parts of the file at once. Opened read-only, read-write for an existing file, or as a new file of a given
+// size that is created or truncated, reading as zeros until written.
+// Throws std::runtime_error if the file cannot be opened, read or written. The file is closed on destruction.
+class PositionalFile {
+public:
+	enum class Mode { read, readWrite, create };
+
+	PositionalFile();
+	PositionalFile(const std::string& filename, Mode mode, uint64_t createSize = 0);
+	PositionalFile(PositionalFile&& other) noexcept;
+	PositionalFile& operator=(PositionalFile&& other) noexcept;
+	PositionalFile(const PositionalFile&) = delete;
+	PositionalFile& operator=(const PositionalFile&) = delete;
+	~PositionalFile();
+
+	// Read exactly size bytes starting at offset.
+	void read(uint64_t offset, void* data, size_t size) const;
+	// Write size bytes starting at offset.
+	void write(uint64_t offset, const void* data, size_t size);
+
+	// Size when opened or created.
+	uint64_t size() const {
+		return length;
+	}
+
+	const std::string& filename() const {
+		return name;
+	}
+
+	void close();
+
+private:
+	std::string name;
+	uint64_t length;
+#ifdef _WIN32
+	void* fileHandle;
+#else
+	int descriptor;
+#endif
+};
+
+// True if both names refer to the same existing file, however the paths are spelled, such as a.bin and ./a.bin.
+bool isSameFile(const std::string& first, const std::string& second);
+
+// Rename from to to, replacing any file already named to. Throws std::runtime_error if it cannot.
+void replaceFile(const std::string& from, const std::string& to);
@@ -0,0 +1,230 @@
+#include "QueueSimulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using namespace std;
+
+// Substream of the simulation's sampler used for service times, far beyond the blocks the arrivals use.
+static const unsigned long long serviceSubstream = ~0ull - 1;
+
+
+bool parseServiceDistribution(const string& name, ServiceDistribution& distribution) {
+	if (name == "exponential") {
+		distribution = ServiceDistribution::exponential;
+	}
+	else if (name == "deterministic") {
+		distribution = ServiceDistribution::deterministic;
+	}
+	else if (name == "uniform") {
+		distribution = ServiceDistribution::uniform;
+	}
+	else if (name == "lognormal") {
+		distribution = ServiceDistribution::lognormal;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+
+DurationHistogram::DurationHistogram() :
+	buckets((maximumExponent - minimumExponent) * subBuckets, 0),
+	total(0) {}
+
+
+void DurationHistogram::add(double duration) {
+	// Bucket by binary exponent and the leading 6 bits of the mantissa. Durations outside the range are clamped to
+	// the first or last bucket.
+	size_t bucket = 0;
+	if (duration > 0) {
+		int exponent;
+		double mantissa = frexp(duration, &exponent);
+		if (exponent >= maximumExponent) {
+			bucket = buckets.size() - 1;
+		}
+		else if (exponent > minimumExponent) {
+			bucket = static_cast<size_t>(exponent - minimumExponent) * subBuckets +
+				static_cast<size_t>((2 * mantissa - 1) * subBuckets);
+		}
+	}
+
+	buckets[bucket]++;
+	total++;
+}
+
+
+double DurationHistogram::quantile(double probability) const {
+	// Return the midpoint of the bucket holding the value of the given rank.
+	if (total == 0) {
+		return 0;
+	}
+
+	unsigned long long rank = static_cast<unsigned long long>(ceil(probability * total));
+	rank = max(1ull, min(rank, total));
+	unsigned long long cumulative = 0;
+	size_t bucket = 0;
+	while (cumulative + buckets[bucket] < rank) {
+		cumulative += buckets[bucket];
+		bucket++;
+	}
+	if (bucket == 0) {
+		return 0;
+	}
+
+	int exponent = static_cast<int>(bucket / subBuckets) + minimumExponent;
+	double mantissa = 0.5 * (1 + (bucket % subBuckets + 0.5) / subBuckets);
+	return ldexp(mantissa, exponent);
+}
+
+
+unsigned long long DurationHistogram::count() const {
+	return total;
+}
+
+
+double QueueStatistics::utilization(unsigned int servers) const {
+	return elapsedTime > 0 ? busyServerTime / (servers * elapsedTime) : 0;
+}
+
+
+double QueueStatistics::meanQueueLength() const {
+	return elapsedTime > 0 ? queueLengthTime / elapsedTime : 0;
+}
+
+
+double QueueStatistics::latencyStandardDeviation() const {
+	return customers > 1 ? sqrt(latencySquares / (customers - 1)) : 0;
+}
+
+
+QueueSimulation::QueueSimulation(
+	const PoissonSampler& sampler, double arrivalRate, double serviceRate, unsigned int servers,
+	unsigned long long customers, ServiceDistribution serviceDistribution, double serviceCV, unsigned int threads) :
+	arrivals(sampler, arrivalRate, customers, threads),
+	serviceSampler(sampler.substream(serviceSubstream)),
+	meanServiceTime(1 / serviceRate),
+	distribution(serviceDistribution),
+	serverCount(servers),
+	busyServers(0),
+	remainingCustomers(customers),
+	stats{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, DurationHistogram() } {
+	// A lognormal with mean m and coefficient of variation v has sigma^2 = log(1 + v^2) and mu = log(m) - sigma^2 / 2.
+	lognormalSigma = sqrt(log1p(serviceCV * serviceCV));
+	lognormalMu = log(meanServiceTime) - lognormalSigma * lognormalSigma / 2;
+
+	scheduleArrivals();
+}
+
+
+void QueueSimulation::scheduleArrivals() {
+	// Schedule the next chunk of arrivals. The last one is marked, so the chunk after it is scheduled when it is
+	// popped, before any later event.
+	const vector<double>& arrivalTimes = arrivals.next();
+	for (size_t i = 0; i < arrivalTimes.size(); i++) {
+		SimulationEvent* event = pool.allocate();
+		event->time = arrivalTimes[i];
+		event->customerArrivalTime = arrivalTimes[i];
+		event->type = SimulationEvent::Type::arrival;
+		event->lastOfChunk = i + 1 == arrivalTimes.size();
+		events.push(event);
+	}
+}
+
+
+double QueueSimulation::sampleServiceTime() {
+	switch (distribution) {
+	case ServiceDistribution::deterministic:
+		return meanServiceTime;
+	case ServiceDistribution::uniform:
+		return 2 * meanServiceTime * serviceSampler.sampleUniform();
+	case ServiceDistribution::lognormal: {
+		// Box-Muller transform of two uniforms, the first taken from (0, 1] so its log is finite.
+		double radius = sqrt(-2 * log(1 - serviceSampler.sampleUniform()));
+		double normal = radius * cos(2 * 3.14159265358979323846 * serviceSampler.sampleUniform());
+		return exp(lognormalMu + lognormalSigma * normal);
+	}
+	default:
+		return serviceSampler.sampleExponential(1 / meanServiceTime);
+	}
+}
+
+
+void QueueSimulation::startService(double time, double customerArrivalTime) {
+	double wait = time - customerArrivalTime;
+	stats.servicesStarted++;
+	stats.meanWait += (wait - stats.meanWait) / stats.servicesStarted;
+
+	SimulationEvent* departure = pool.allocate();
+	departure->time = time + sampleServiceTime();
+	departure->customerArrivalTime = customerArrivalTime;
+	departure->type = SimulationEvent::Type::departure;
+	departure->lastOfChunk = false;
+	events.push(departure);
+}
+
+
+bool QueueSimulation::run(unsigned long long count) {
+	unsigned long long target = stats.customers + min(count, remainingCustomers);
+
+	while (stats.customers < target) {
+		SimulationEvent* event = events.pop();
+
+		// Integrate the number of busy servers and waiting customers over the time since the previous event.
+		double interval = event->time - stats.elapsedTime;
+		stats.busyServerTime += busyServers * interval;
+		stats.queueLengthTime += waiting.size() * interval;
+		stats.elapsedTime = event->time;
+
+		if (event->type == SimulationEvent::Type::arrival) {
+			if (event->lastOfChunk && arrivals.remaining() > 0) {
+				scheduleArrivals();
+			}
+			if (busyServers < serverCount) {
+				busyServers++;
+				startService(event->time, event->customerArrivalTime);
+			}
+			else {
+				waiting.push_back(event->customerArrivalTime);
+				stats.maximumQueueLength = max(stats.maximumQueueLength, waiting.size());
+			}
+		}
+		else {
+			// Welford's update of the latency mean and sum of squared deviations.
+			double latency = event->time - event->customerArrivalTime;
+			stats.customers++;
+			double delta = latency - stats.meanLatency;
+			stats.meanLatency += delta / stats.customers;
+			stats.latencySquares += delta * (latency - stats.meanLatency);
+			stats.maximumLatency = max(stats.maximumLatency, latency);
+			stats.latency.add(latency);
+
+			if (waiting.empty()) {
+				busyServers--;
+			}
+			else {
+				double customerArrivalTime = waiting.front();
+				waiting.pop_front();
+				startService(event->time, customerArrivalTime);
+			}
+		}
+
+		pool.release(event);
+	}
+
+	remainingCustomers -= min(count, remainingCustomers);
+	return remainingCustomers > 0;
+}
+
+
+const QueueStatistics& QueueSimulation::statistics() const {
+	return stats;
+}
+
+
+unsigned int QueueSimulation::servers() const {
+	return serverCount;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "CalendarQueue.hpp"
+#include "PoissonProcess.hpp"
+
+// Service time distributions of the M/G/c simulation, each with mean 1 / serviceRate.
+// exponential:   M/M/c.
+// deterministic: every service takes exactly the mean.
+// uniform:       uniform on [0, 2 * mean].
+// lognormal:     lognormal with coefficient of variation serviceCV.
+enum class ServiceDistribution { exponential, deterministic, uniform, lognormal };
+
+bool parseServiceDistribution(const std::string& name, ServiceDistribution& distribution);
+
+// Histogram of non-negative durations in logarithmic buckets, 64 per power of two, so quantiles are accurate to
+// about 1% in constant memory however many values are added.
+class DurationHistogram {
+public:
+	DurationHistogram();
+
+	void add(double duration);
+	double quantile(double probability) const;
+	unsigned long long count() const;
+
+private:
+	static const int minimumExponent = -40;
+	static const int maximumExponent = 64;
+	static const int subBuckets = 64;
+
+	std::vector<unsigned long long> buckets;
+	unsigned long long total;
+};
+
+// Running statistics of a queue simulation. Latency is the time from arrival to departure, over departed customers,
+// and wait the time from arrival to the start of service, over customers whose service has started. Utilization is the busy server time divided by servers times elapsed time.
+struct QueueStatistics {
+	unsigned long long customers;
+	unsigned long long servicesStarted;
+	double elapsedTime;
+	double busyServerTime;
+	double queueLengthTime;
+	double meanWait;
+	double meanLatency;
+	double latencySquares;
+	double maximumLatency;
+	size_t maximumQueueLength;
+	DurationHistogram latency;
+
+	double utilization(unsigned int servers) const;
+	double meanQueueLength() const;
+	double latencyStandardDeviation() const;
+};
+
+// First come, first served queue with c servers fed by a Poisson process, simulated event by event. Arrival times
+// come from PoissonArrivalStream a chunk at a time, so the arrivals are exactly those sample-arrival-times draws for
+// the same sampler. Service times come from a separate substream of the sampler.
+class QueueSimulation {
+public:
+	QueueSimulation(
+		const PoissonSampler& sampler, double arrivalRate, double serviceRate, unsigned int servers,
+		unsigned long long customers, ServiceDistribution distribution, double serviceCV = 1, unsigned int threads = 1);
+
+	// Simulate until count more customers have departed or every customer has, and return whether any remain. A count
+	// of 0 simulates nothing, so a caller looping until none remain must pass at least 1.
+	bool run(unsigned long long count);
+	const QueueStatistics& statistics() const;
+	unsigned int servers() const;
+
+private:
+	void scheduleArrivals();
+	void startService(double time, double customerArrivalTime);
+	double sampleServiceTime();
+
+	PoissonArrivalStream arrivals;
+	PoissonSampler serviceSampler;
+	double meanServiceTime;
+	double lognormalMu;
+	double lognormalSigma;
+	ServiceDistribution distribution;
+	unsigned int serverCount;
+	unsigned int busyServers;
+	unsigned long long remainingCustomers;
+	std::deque<double> waiting;
+	SimulationEventPool pool;
+	CalendarQueue events;
+	QueueStatistics stats;
+};
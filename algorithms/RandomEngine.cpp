@@ -0,0 +1,213 @@
+#include "RandomEngine.hpp"
+
+#include <memory>
+#include <random>
+#include <string>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+bool parseRandomEngineType(const string& name, RandomEngineType& type) {
+	if (name == "mt19937") {
+		type = RandomEngineType::mt19937;
+	}
+	else if (name == "xoshiro") {
+		type = RandomEngineType::xoshiro;
+	}
+	else if (name == "philox") {
+		type = RandomEngineType::philox;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+
+unique_ptr<RandomEngine> makeRandomEngine(RandomEngineType type, unsigned long long seed, unsigned long long stream) {
+	switch (type) {
+	case RandomEngineType::xoshiro:
+		return unique_ptr<RandomEngine>(new XoshiroEngine(seed, stream));
+	case RandomEngineType::philox:
+		return unique_ptr<RandomEngine>(new PhiloxEngine(seed, stream));
+	case RandomEngineType::mt19937:
+	default:
+		return unique_ptr<RandomEngine>(new MersenneTwisterEngine(seed, stream));
+	}
+}
+
+
+static uint64_t splitMix64(uint64_t& state) {
+	// SplitMix64 (Steele, Lea and Flood), used to expand seeds into well mixed engine states.
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+static uint64_t mixStream(unsigned long long seed, unsigned long long stream) {
+	// Combine seed and stream index into one well mixed word.
+	uint64_t seedState = seed;
+	uint64_t streamState = stream ^ 0x6A09E667F3BCC909ULL;
+	return splitMix64(seedState) ^ splitMix64(streamState);
+}
+
+
+MersenneTwisterEngine::MersenneTwisterEngine(unsigned long long seed, unsigned long long stream) :
+	generator(seed) {
+	// The root stream keeps the plain seeding used before engines were pluggable.
+	if (stream > 0) {
+		unsigned long long index = stream - 1;
+		seed_seq sequence{
+			static_cast<unsigned int>(seed), static_cast<unsigned int>(seed >> 32),
+			static_cast<unsigned int>(index), static_cast<unsigned int>(index >> 32) };
+		generator.seed(sequence);
+	}
+}
+
+
+void MersenneTwisterEngine::fill(uint64_t* words, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		words[i] = generator();
+	}
+}
+
+
+void MersenneTwisterEngine::discard(unsigned long long count) {
+	generator.discard(count);
+}
+
+
+unique_ptr<RandomEngine> MersenneTwisterEngine::clone() const {
+	return unique_ptr<RandomEngine>(new MersenneTwisterEngine(*this));
+}
+
+
+static inline uint64_t rotateLeft(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+
+XoshiroEngine::XoshiroEngine(unsigned long long seed, unsigned long long stream) {
+	uint64_t seedState = mixStream(seed, stream);
+	for (int i = 0; i < 4; i++) {
+		state[i] = splitMix64(seedState);
+	}
+}
+
+
+void XoshiroEngine::fill(uint64_t* words, size_t count) {
+	uint64_t s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+	for (size_t i = 0; i < count; i++) {
+		words[i] = rotateLeft(s0 + s3, 23) + s0;
+		uint64_t t = s1 << 17;
+		s2 ^= s0;
+		s3 ^= s1;
+		s1 ^= s2;
+		s0 ^= s3;
+		s2 ^= t;
+		s3 = rotateLeft(s3, 45);
+	}
+	state[0] = s0;
+	state[1] = s1;
+	state[2] = s2;
+	state[3] = s3;
+}
+
+
+void XoshiroEngine::discard(unsigned long long count) {
+	uint64_t words[64];
+	while (count > 0) {
+		size_t chunk = static_cast<size_t>(count < 64 ? count : 64);
+		fill(words, chunk);
+		count -= chunk;
+	}
+}
+
+
+unique_ptr<RandomEngine> XoshiroEngine::clone() const {
+	return unique_ptr<RandomEngine>(new XoshiroEngine(*this));
+}
+
+
+static inline uint64_t multiplyHighLow(uint64_t a, uint64_t b, uint64_t& high) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return _umul128(a, b, &high);
+#elif defined(__SIZEOF_INT128__)
+	unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+	high = static_cast<uint64_t>(product >> 64);
+	return static_cast<uint64_t>(product);
+#else
+	uint64_t aLow = a & 0xFFFFFFFF, aHigh = a >> 32, bLow = b & 0xFFFFFFFF, bHigh = b >> 32;
+	uint64_t lowLow = aLow * bLow, highLow = aHigh * bLow, lowHigh = aLow * bHigh, highHigh = aHigh * bHigh;
+	uint64_t middle = (lowLow >> 32) + (highLow & 0xFFFFFFFF) + lowHigh;
+	high = highHigh + (highLow >> 32) + (middle >> 32);
+	return (middle << 32) | (lowLow & 0xFFFFFFFF);
+#endif
+}
+
+
+PhiloxEngine::PhiloxEngine(unsigned long long seed, unsigned long long stream) :
+	position(0) {
+	// The stream index is part of the key, so streams are distinct permutations of the same counters.
+	key[0] = seed;
+	key[1] = mixStream(seed, stream);
+}
+
+
+void PhiloxEngine::encrypt(const uint64_t counter[4], const uint64_t inputKey[2], uint64_t output[4]) {
+	const uint64_t multiplier0 = 0xD2E7470EE14C6C93ULL;
+	const uint64_t multiplier1 = 0xCA5A826395121157ULL;
+	const uint64_t weyl0 = 0x9E3779B97F4A7C15ULL;
+	const uint64_t weyl1 = 0xBB67AE8584CAA73BULL;
+
+	uint64_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	uint64_t k0 = inputKey[0], k1 = inputKey[1];
+	for (int round = 0; round < 10; round++) {
+		uint64_t high0, high1;
+		uint64_t low0 = multiplyHighLow(multiplier0, c0, high0);
+		uint64_t low1 = multiplyHighLow(multiplier1, c2, high1);
+		c0 = high1 ^ c1 ^ k0;
+		c1 = low1;
+		c2 = high0 ^ c3 ^ k1;
+		c3 = low0;
+		k0 += weyl0;
+		k1 += weyl1;
+	}
+
+	output[0] = c0;
+	output[1] = c1;
+	output[2] = c2;
+	output[3] = c3;
+}
+
+
+void PhiloxEngine::fill(uint64_t* words, size_t count) {
+	// Word n of the stream is word n % 4 of the encryption of counter n / 4.
+	uint64_t counter[4] = { 0, 0, 0, 0 };
+	uint64_t output[4];
+	size_t i = 0;
+	while (i < count) {
+		counter[0] = position / 4;
+		encrypt(counter, key, output);
+		for (unsigned int word = static_cast<unsigned int>(position % 4); word < 4 && i < count; word++) {
+			words[i++] = output[word];
+			position++;
+		}
+	}
+}
+
+
+void PhiloxEngine::discard(unsigned long long count) {
+	position += count;
+}
+
+
+unique_ptr<RandomEngine> PhiloxEngine::clone() const {
+	return unique_ptr<RandomEngine>(new PhiloxEngine(*this));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+
+// 64 bit random engines the samplers can draw from.
+// mt19937:  std::mt19937_64, the original engine. 2.5 KB of state, sequential access only.
+// xoshiro:  xoshiro256++ (Blackman and Vigna), 32 bytes of state and the highest throughput.
+// philox:   Philox4x64-10 (Salmon et al., Random123), counter based, so any position of a stream can be
+//           reached in O(1) by seek.
+enum class RandomEngineType { mt19937, xoshiro, philox };
+
+bool parseRandomEngineType(const std::string& name, RandomEngineType& type);
+
+class RandomEngine {
+public:
+	virtual ~RandomEngine() {}
+
+	virtual void fill(uint64_t* words, size_t count) = 0;
+	virtual void discard(unsigned long long count) = 0;
+	virtual std::unique_ptr<RandomEngine> clone() const = 0;
+
+	// Whether discard is O(1), so the n-th word of a stream can be drawn without generating the ones before it.
+	virtual bool randomAccess() const {
+		return false;
+	}
+};
+
+// Return the engine for stream 0 (the root stream) or stream i + 1 (substream i) of the given seed. Streams of
+// one seed are statistically independent of each other.
+std::unique_ptr<RandomEngine> makeRandomEngine(RandomEngineType type, unsigned long long seed, unsigned long long stream);
+
+
+class MersenneTwisterEngine : public RandomEngine {
+public:
+	MersenneTwisterEngine(unsigned long long seed, unsigned long long stream);
+
+	virtual void fill(uint64_t* words, size_t count);
+	virtual void discard(unsigned long long count);
+	virtual std::unique_ptr<RandomEngine> clone() const;
+
+private:
+	std::mt19937_64 generator;
+};
+
+
+class XoshiroEngine : public RandomEngine {
+public:
+	XoshiroEngine(unsigned long long seed, unsigned long long stream);
+
+	virtual void fill(uint64_t* words, size_t count);
+	virtual void discard(unsigned long long count);
+	virtual std::unique_ptr<RandomEngine> clone() const;
+
+private:
+	uint64_t state[4];
+};
+
+
+class PhiloxEngine : public RandomEngine {
+public:
+	PhiloxEngine(unsigned long long seed, unsigned long long stream);
+
+	virtual void fill(uint64_t* words, size_t count);
+	virtual void discard(unsigned long long count);
+	virtual std::unique_ptr<RandomEngine> clone() const;
+	virtual bool randomAccess() const {
+		return true;
+	}
+
+	// Philox4x64-10 bijection of a 256 bit counter under a 128 bit key.
+	static void encrypt(const uint64_t counter[4], const uint64_t key[2], uint64_t output[4]);
+
+private:
+	uint64_t key[2];
+	unsigned long long position;
+};
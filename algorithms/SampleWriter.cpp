@@ -0,0 +1,180 @@
+#include "SampleWriter.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <stdio.h>
+#endif
+
+using namespace std;
+
+static const size_t sampleBufferSize = 1 << 20;
+static const size_t maxFormattedLineSize = 96;
+
+
+bool parseSampleFormat(const string& name, SampleFormat& format) {
+	if (name == "text") {
+		format = SampleFormat::text;
+	}
+	else if (name == "csv") {
+		format = SampleFormat::csv;
+	}
+	else if (name == "raw") {
+		format = SampleFormat::raw;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool isLittleEndian() {
+	uint16_t one = 1;
+	unsigned char firstByte;
+	memcpy(&firstByte, &one, 1);
+	return firstByte == 1;
+}
+
+
+static void storeLittleEndian(uint64_t bits, char* destination) {
+	for (int byte = 0; byte < 8; byte++) {
+		destination[byte] = static_cast<char>((bits >> (8 * byte)) & 0xFF);
+	}
+}
+
+
+static void storeLittleEndian(double value, char* destination) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	storeLittleEndian(bits, destination);
+}
+
+
+SampleWriter::SampleWriter(
+	SampleFormat outputFormat, const string& filename, const string& valueName, unsigned long long totalCount,
+	const string& labelName) :
+	format(outputFormat),
+	labelled(!labelName.empty()),
+	stream(&cout),
+	mappedOffset(0),
+	buffer(sampleBufferSize),
+	bufferUsed(0),
+	index(0) {
+	if (format == SampleFormat::raw && !filename.empty()) {
+		mapping = MappedFile(filename, MappedFile::Mode::create, static_cast<size_t>(totalCount * recordSize()));
+		return;
+	}
+
+	if (!filename.empty()) {
+		file.open(filename, ios::binary);
+		if (!file) {
+			throw runtime_error("Cannot open " + filename + ".");
+		}
+		stream = &file;
+	}
+#ifdef _WIN32
+	else if (format == SampleFormat::raw) {
+		// Keep the console runtime from translating bytes that happen to be '\n'.
+		cout.flush();
+		_setmode(_fileno(stdout), _O_BINARY);
+	}
+#endif
+
+	if (format == SampleFormat::csv) {
+		string header = "index," + valueName + (labelled ? "," + labelName : "") + "\n";
+		stream->write(header.data(), header.size());
+	}
+}
+
+
+SampleWriter::~SampleWriter() {
+	flush();
+}
+
+
+void SampleWriter::reserve(size_t bytes) {
+	if (bufferUsed + bytes > buffer.size()) {
+		flush();
+	}
+}
+
+
+size_t SampleWriter::recordSize() const {
+	return labelled ? sizeof(double) + sizeof(uint64_t) : sizeof(double);
+}
+
+
+void SampleWriter::write(const double* values, size_t count) {
+	write(values, nullptr, count);
+}
+
+
+void SampleWriter::write(const double* values, const unsigned long long* labels, size_t count) {
+	if (format == SampleFormat::raw) {
+		if (mapping.data() != nullptr) {
+			char* destination = mapping.data() + mappedOffset;
+			if (labels == nullptr && isLittleEndian()) {
+				memcpy(destination, values, count * sizeof(double));
+			}
+			else {
+				for (size_t i = 0; i < count; i++) {
+					storeLittleEndian(values[i], destination);
+					destination += sizeof(double);
+					if (labels != nullptr) {
+						storeLittleEndian(static_cast<uint64_t>(labels[i]), destination);
+						destination += sizeof(uint64_t);
+					}
+				}
+			}
+			mappedOffset += count * recordSize();
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			reserve(recordSize());
+			storeLittleEndian(values[i], buffer.data() + bufferUsed);
+			bufferUsed += sizeof(double);
+			if (labels != nullptr) {
+				storeLittleEndian(static_cast<uint64_t>(labels[i]), buffer.data() + bufferUsed);
+				bufferUsed += sizeof(uint64_t);
+			}
+		}
+		index += count;
+		return;
+	}
+
+	char* const bufferEnd = buffer.data() + buffer.size();
+	char separator = format == SampleFormat::csv ? ',' : ' ';
+	for (size_t i = 0; i < count; i++) {
+		reserve(maxFormattedLineSize);
+		char* position = buffer.data() + bufferUsed;
+		if (format == SampleFormat::csv) {
+			position = to_chars(position, bufferEnd, index).ptr;
+			*position++ = ',';
+		}
+		position = to_chars(position, bufferEnd, values[i]).ptr;
+		if (labels != nullptr) {
+			*position++ = separator;
+			position = to_chars(position, bufferEnd, labels[i]).ptr;
+		}
+		*position++ = '\n';
+		bufferUsed = position - buffer.data();
+		index++;
+	}
+}
+
+
+void SampleWriter::flush() {
+	if (bufferUsed > 0) {
+		stream->write(buffer.data(), bufferUsed);
+		bufferUsed = 0;
+	}
+	stream->flush();
+}
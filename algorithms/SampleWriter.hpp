@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include "MappedFile.hpp"
+
+// Output formats of the sampler subcommands.
+// text: one value per line in the shortest form that reads back to the same double.
+// csv:  a header line, then "index,value" per line.
+// raw:  little-endian float64 values with no separators.
+// Writers given a label name also write an integer label with each value, as "value label" in text, an extra
+// column in csv and a little-endian uint64 after each float64 in raw.
+enum class SampleFormat { text, csv, raw };
+
+bool parseSampleFormat(const std::string& name, SampleFormat& format);
+
+// Buffered writer of sampled values to stdout, or to a file when a filename is given. Values are formatted with
+// std::to_chars into a large buffer rather than through iostream formatting. Raw output to a file is written
+// through a memory mapping sized for totalCount values.
+class SampleWriter {
+public:
+	SampleWriter(
+		SampleFormat format, const std::string& filename, const std::string& valueName, unsigned long long totalCount,
+		const std::string& labelName = "");
+	~SampleWriter();
+
+	void write(const double* values, size_t count);
+	void write(const double* values, const unsigned long long* labels, size_t count);
+	void flush();
+
+private:
+	void reserve(size_t bytes);
+	size_t recordSize() const;
+
+	SampleFormat format;
+	bool labelled;
+	std::ofstream file;
+	std::ostream* stream;
+	MappedFile mapping;
+	size_t mappedOffset;
+	std::vector<char> buffer;
+	size_t bufferUsed;
+	unsigned long long index;
+};
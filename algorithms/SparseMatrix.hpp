@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Matrix.hpp"
+#include "MatrixView.hpp"
+#include "Parallel.hpp"
+
+// Compressed sparse matrices hold only their non-zero elements, so memory is proportional to the number of non-zeros
+// plus one offset per row (CSR) or column (CSC). The outer dimension is rows for CSR and columns for CSC; the
+// non-zeros of outer index i are entries offsets()[i]..offsets()[i+1]-1 of indices(), holding their inner index in
+// increasing order without repeats, and values(). Inner indices are 32 bits, so a dimension may be up to 2^32-1.
+enum class SparseLayout { rowMajor, columnMajor };
+
+template<class elementType, SparseLayout layout>
+class CompressedSparseMatrix {
+public:
+	typedef elementType value_type;
+	typedef uint32_t index_type;
+
+	CompressedSparseMatrix() :
+		rows(0),
+		cols(0),
+		outerOffsets(1, 0) {}
+
+	// Take over compressed arrays that already satisfy the invariants above. Throws std::runtime_error if their sizes
+	// are inconsistent.
+	CompressedSparseMatrix(unsigned long dataRows, unsigned long dataCols,
+		std::vector<size_t>&& offsets, std::vector<index_type>&& indices, std::vector<elementType>&& values) :
+		rows(dataRows),
+		cols(dataCols),
+		outerOffsets(std::move(offsets)),
+		innerIndices(std::move(indices)),
+		nonZeroValues(std::move(values)) {
+		if (outerOffsets.size() != outerSize() + 1 || outerOffsets.front() != 0 ||
+			outerOffsets.back() != innerIndices.size() || innerIndices.size() != nonZeroValues.size()) {
+			throw std::runtime_error("Inconsistent compressed sparse matrix arrays.");
+		}
+	}
+
+	// Sparse copy of the non-zero elements of a dense matrix or view.
+	static CompressedSparseMatrix fromDense(const MatrixView<elementType>& dense) {
+		unsigned long outer = layout == SparseLayout::rowMajor ? dense.nRows() : dense.nCols();
+		unsigned long inner = layout == SparseLayout::rowMajor ? dense.nCols() : dense.nRows();
+		auto element = [&](unsigned long i, unsigned long j) {
+			return layout == SparseLayout::rowMajor ? dense(i, j) : dense(j, i);
+		};
+
+		std::vector<size_t> offsets(outer + 1, 0);
+		std::vector<index_type> indices;
+		std::vector<elementType> values;
+		for (unsigned long i = 0; i < outer; i++) {
+			for (unsigned long j = 0; j < inner; j++) {
+				elementType value = element(i, j);
+				if (value != 0) {
+					indices.push_back(static_cast<index_type>(j));
+					values.push_back(value);
+				}
+			}
+			offsets[i + 1] = indices.size();
+		}
+
+		return CompressedSparseMatrix(
+			dense.nRows(), dense.nCols(), std::move(offsets), std::move(indices), std::move(values));
+	}
+
+	Matrix<elementType> toDense() const {
+		Matrix<elementType> dense(rows, cols);
+		for (size_t i = 0; i < outerSize(); i++) {
+			for (size_t nz = outerOffsets[i]; nz < outerOffsets[i + 1]; nz++) {
+				if (layout == SparseLayout::rowMajor) {
+					dense(static_cast<unsigned long>(i), innerIndices[nz]) = nonZeroValues[nz];
+				}
+				else {
+					dense(innerIndices[nz], static_cast<unsigned long>(i)) = nonZeroValues[nz];
+				}
+			}
+		}
+		return dense;
+	}
+
+	// Element (row, col), found by binary search among the non-zeros of its row or column.
+	elementType operator()(unsigned long row, unsigned long col) const {
+		size_t outer = layout == SparseLayout::rowMajor ? row : col;
+		index_type inner = static_cast<index_type>(layout == SparseLayout::rowMajor ? col : row);
+		auto first = innerIndices.begin() + outerOffsets[outer];
+		auto last = innerIndices.begin() + outerOffsets[outer + 1];
+		auto found = std::lower_bound(first, last, inner);
+		return found != last && *found == inner ? nonZeroValues[found - innerIndices.begin()] : elementType(0);
+	}
+
+	unsigned long nRows() const {
+		return rows;
+	}
+
+	unsigned long nCols() const {
+		return cols;
+	}
+
+	size_t nonZeros() const {
+		return innerIndices.size();
+	}
+
+	size_t outerSize() const {
+		return layout == SparseLayout::rowMajor ? rows : cols;
+	}
+
+	const std::vector<size_t>& offsets() const {
+		return outerOffsets;
+	}
+
+	const std::vector<index_type>& indices() const {
+		return innerIndices;
+	}
+
+	const std::vector<elementType>& values() const {
+		return nonZeroValues;
+	}
+
+private:
+	unsigned long rows;
+	unsigned long cols;
+	std::vector<size_t> outerOffsets;
+	std::vector<index_type> innerIndices;
+	std::vector<elementType> nonZeroValues;
+};
+
+template<class elementType>
+using CsrMatrix = CompressedSparseMatrix<elementType, SparseLayout::rowMajor>;
+
+template<class elementType>
+using CscMatrix = CompressedSparseMatrix<elementType, SparseLayout::columnMajor>;
+
+
+template<class elementType, SparseLayout layout>
+CompressedSparseMatrix<elementType, layout == SparseLayout::rowMajor ? SparseLayout::columnMajor : SparseLayout::rowMajor>
+changeSparseLayout(const CompressedSparseMatrix<elementType, layout>& matrix) {
+	// Counting sort of the non-zeros by inner index. Visiting outer indices in order leaves the new inner indices
+	// sorted.
+
+	const SparseLayout otherLayout = layout == SparseLayout::rowMajor ? SparseLayout::columnMajor : SparseLayout::rowMajor;
+	size_t otherOuterSize = layout == SparseLayout::rowMajor ? matrix.nCols() : matrix.nRows();
+
+	std::vector<size_t> offsets(otherOuterSize + 1, 0);
+	for (auto index : matrix.indices()) {
+		offsets[index + 1]++;
+	}
+	for (size_t i = 0; i < otherOuterSize; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	std::vector<uint32_t> indices(matrix.nonZeros());
+	std::vector<elementType> values(matrix.nonZeros());
+	for (size_t i = 0; i < matrix.outerSize(); i++) {
+		for (size_t nz = matrix.offsets()[i]; nz < matrix.offsets()[i + 1]; nz++) {
+			size_t position = next[matrix.indices()[nz]]++;
+			indices[position] = static_cast<uint32_t>(i);
+			values[position] = matrix.values()[nz];
+		}
+	}
+
+	return CompressedSparseMatrix<elementType, otherLayout>(
+		matrix.nRows(), matrix.nCols(), std::move(offsets), std::move(indices), std::move(values));
+}
+
+template<class elementType>
+CscMatrix<elementType> toCsc(const CsrMatrix<elementType>& matrix) {
+	return changeSparseLayout(matrix);
+}
+
+template<class elementType>
+CsrMatrix<elementType> toCsr(const CscMatrix<elementType>& matrix) {
+	return changeSparseLayout(matrix);
+}
+
+
+// Below this many multiply-adds a sparse product runs on the calling thread.
+const double sparseParallelThreshold = 1 << 16;
+
+template<class elementType>
+void multiply(const CsrMatrix<elementType>& a, const elementType* x, size_t ldx, size_t k, elementType* y, size_t ldy,
+	unsigned int threads = 0) {
+	// Y := A * X for the nCols x k row-major X with rows ldx apart, into the nRows x k Y with rows ldy apart.
+	//
+	// The work is split by merge path (Merrill and Garland): walking the rows and the non-zeros together is a path of
+	// nRows + nonZeros steps, cut into one equal segment per thread. Every segment has the same number of rows plus
+	// non-zeros however they are distributed, so a few very long rows, as in power-law graphs, cannot leave threads
+	// idle. A row cut by a segment boundary is finished by adding the earlier segments' partial sums afterwards.
+
+	const size_t rows = a.nRows();
+	const size_t nonZeros = a.nonZeros();
+	const size_t* offsets = a.offsets().data();
+	const uint32_t* indices = a.indices().data();
+	const elementType* values = a.values().data();
+
+	threads = resolveThreadCount(threads);
+	if (static_cast<double>(nonZeros) * k < sparseParallelThreshold) {
+		threads = 1;
+	}
+
+	struct PathCoordinate {
+		size_t row;
+		size_t nonZero;
+	};
+	auto searchPath = [&](size_t diagonal) {
+		// Find where the path crosses the diagonal row + nonZero = diagonal. Row ends come before the non-zeros at
+		// the same position, so an empty row is consumed as soon as it is reached.
+		size_t low = diagonal > nonZeros ? diagonal - nonZeros : 0;
+		size_t high = std::min(diagonal, rows);
+		while (low < high) {
+			size_t pivot = low + (high - low) / 2;
+			if (offsets[pivot + 1] <= diagonal - pivot - 1) {
+				low = pivot + 1;
+			}
+			else {
+				high = pivot;
+			}
+		}
+		return PathCoordinate{ low, diagonal - low };
+	};
+
+	size_t pathLength = rows + nonZeros;
+	size_t segments = std::max<size_t>(1, std::min<size_t>(threads, pathLength));
+	std::vector<size_t> carryRows(segments, rows);
+	std::vector<elementType> carries(segments * k, 0);
+
+	parallelFor(segments, threads, [&](size_t firstSegment, size_t lastSegment) {
+		std::vector<elementType> sums(k);
+		for (size_t segment = firstSegment; segment < lastSegment; segment++) {
+			PathCoordinate start = searchPath(pathLength * segment / segments);
+			PathCoordinate end = searchPath(pathLength * (segment + 1) / segments);
+
+			size_t nz = start.nonZero;
+			for (size_t row = start.row; row < end.row; row++) {
+				elementType* yRow = y + row * ldy;
+				if (k == 1) {
+					elementType sum = 0;
+					for (; nz < offsets[row + 1]; nz++) {
+						sum += values[nz] * x[indices[nz] * ldx];
+					}
+					yRow[0] = sum;
+				}
+				else {
+					std::fill(sums.begin(), sums.end(), elementType(0));
+					for (; nz < offsets[row + 1]; nz++) {
+						const elementType* xRow = x + indices[nz] * ldx;
+						for (size_t c = 0; c < k; c++) {
+							sums[c] += values[nz] * xRow[c];
+						}
+					}
+					std::copy(sums.begin(), sums.end(), yRow);
+				}
+			}
+
+			// The start of row end.row belongs to this segment and the rest to later ones.
+			carryRows[segment] = end.row;
+			elementType* carry = carries.data() + segment * k;
+			for (; nz < end.nonZero; nz++) {
+				const elementType* xRow = x + indices[nz] * ldx;
+				for (size_t c = 0; c < k; c++) {
+					carry[c] += values[nz] * xRow[c];
+				}
+			}
+		}
+	});
+
+	for (size_t segment = 0; segment < segments; segment++) {
+		if (carryRows[segment] < rows) {
+			elementType* yRow = y + carryRows[segment] * ldy;
+			for (size_t c = 0; c < k; c++) {
+				yRow[c] += carries[segment * k + c];
+			}
+		}
+	}
+}
+
+template<class elementType>
+void multiply(const CscMatrix<elementType>& a, const elementType* x, size_t ldx, size_t k, elementType* y, size_t ldy,
+	unsigned int threads = 0) {
+	// Y := A * X as for CSR. Each column scatters into Y, so the columns are split into one range of about equal
+	// non-zeros per thread, each range accumulating into its own copy of Y, and the copies are summed by row.
+	// This needs nRows * k extra elements per thread; CSR multiplies without them.
+
+	const size_t rows = a.nRows();
+	const size_t cols = a.nCols();
+	const size_t* offsets = a.offsets().data();
+	const uint32_t* indices = a.indices().data();
+	const elementType* values = a.values().data();
+
+	threads = resolveThreadCount(threads);
+	if (static_cast<double>(a.nonZeros()) * k < sparseParallelThreshold) {
+		threads = 1;
+	}
+
+	size_t segments = std::max<size_t>(1, std::min<size_t>(threads, cols));
+	std::vector<size_t> bounds(segments + 1, cols);
+	for (size_t segment = 0; segment < segments; segment++) {
+		size_t target = a.nonZeros() * segment / segments;
+		bounds[segment] = std::lower_bound(offsets, offsets + cols, target) - offsets;
+	}
+	std::vector<elementType> partials((segments - 1) * rows * k);
+
+	parallelFor(segments, threads, [&](size_t firstSegment, size_t lastSegment) {
+		for (size_t segment = firstSegment; segment < lastSegment; segment++) {
+			// The first segment accumulates straight into Y.
+			elementType* target = segment == 0 ? y : partials.data() + (segment - 1) * rows * k;
+			size_t ldt = segment == 0 ? ldy : k;
+			for (size_t row = 0; row < rows; row++) {
+				std::fill(target + row * ldt, target + row * ldt + k, elementType(0));
+			}
+
+			for (size_t col = bounds[segment]; col < bounds[segment + 1]; col++) {
+				const elementType* xRow = x + col * ldx;
+				for (size_t nz = offsets[col]; nz < offsets[col + 1]; nz++) {
+					elementType* tRow = target + indices[nz] * ldt;
+					for (size_t c = 0; c < k; c++) {
+						tRow[c] += values[nz] * xRow[c];
+					}
+				}
+			}
+		}
+	});
+
+	if (segments > 1) {
+		parallelFor(rows, threads, [&](size_t firstRow, size_t lastRow) {
+			for (size_t row = firstRow; row < lastRow; row++) {
+				for (size_t segment = 1; segment < segments; segment++) {
+					const elementType* partial = partials.data() + ((segment - 1) * rows + row) * k;
+					for (size_t c = 0; c < k; c++) {
+						y[row * ldy + c] += partial[c];
+					}
+				}
+			}
+		});
+	}
+}
+
+// Return A * X for a dense X, a vector when it has one column. Throws std::runtime_error when the inner dimensions
+// differ.
+template<class elementType, SparseLayout layout>
+Matrix<elementType> multiply(
+	const CompressedSparseMatrix<elementType, layout>& a, const MatrixView<elementType>& x, unsigned int threads = 0) {
+	if (a.nCols() != x.nRows()) {
+		throw std::runtime_error("Cannot multiply a " + std::to_string(a.nRows()) + "x" + std::to_string(a.nCols()) +
+			" sparse matrix by a " + std::to_string(x.nRows()) + "x" + std::to_string(x.nCols()) + " matrix.");
+	}
+
+	Matrix<elementType> xCopy(0, 0);
+	const elementType* xElements = x.data();
+	size_t ldx = x.nRows() > 1 ? x.rowStride() : x.nCols();
+	if (x.colStride() != 1) {
+		xCopy = x;
+		xElements = xCopy.data();
+		ldx = x.nCols();
+	}
+
+	Matrix<elementType> y(a.nRows(), x.nCols(), MatrixStorage<elementType>(static_cast<size_t>(a.nRows()) * x.nCols()));
+	multiply(a, xElements, ldx, x.nCols(), y.data(), x.nCols(), threads);
+	return y;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Parallel.hpp"
+
+// Set of tasks with dependencies between them, run by a pool of threads. A task becomes ready once every task it
+// depends on has finished, and each free thread takes the ready task of highest priority, the earliest added first
+// among equals. Unlike parallelFor, which waits for a whole loop before the next can start, this lets a task that is
+// on the critical path run as soon as its own inputs are done.
+class TaskGraph {
+public:
+	typedef size_t TaskId;
+
+	// Add a task running work once the dependencies, tasks already added, have finished. Throws std::runtime_error
+	// for a dependency that has not been added, which also keeps the graph free of cycles.
+	TaskId add(std::function<void()> work, const std::vector<TaskId>& dependencies = {}, int priority = 0) {
+		TaskId id = tasks.size();
+		for (TaskId dependency : dependencies) {
+			if (dependency >= id) {
+				throw std::runtime_error("A task can only depend on tasks added before it.");
+			}
+		}
+
+		tasks.push_back(Task{ std::move(work), {}, dependencies.size(), priority });
+		for (TaskId dependency : dependencies) {
+			tasks[dependency].successors.push_back(id);
+		}
+		return id;
+	}
+
+	size_t size() const {
+		return tasks.size();
+	}
+
+	// Run every task on threads threads, 0 for one per core, the calling thread being one of them. If a task throws,
+	// no further tasks are started, and the exception is rethrown once the running ones have finished.
+	void run(unsigned int threads = 0) {
+		if (tasks.empty()) {
+			return;
+		}
+
+		std::vector<size_t> remaining(tasks.size());
+		auto later = [this](TaskId a, TaskId b) {
+			return tasks[a].priority < tasks[b].priority || (tasks[a].priority == tasks[b].priority && a > b);
+		};
+		std::priority_queue<TaskId, std::vector<TaskId>, decltype(later)> ready(later);
+		for (TaskId id = 0; id < tasks.size(); id++) {
+			remaining[id] = tasks[id].dependencies;
+			if (remaining[id] == 0) {
+				ready.push(id);
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable changed;
+		size_t finished = 0;
+		std::exception_ptr failure;
+
+		auto work = [&]() {
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;) {
+				changed.wait(lock, [&]() { return !ready.empty() || finished == tasks.size() || failure; });
+				if (finished == tasks.size() || failure) {
+					return;
+				}
+
+				TaskId id = ready.top();
+				ready.pop();
+				lock.unlock();
+				try {
+					tasks[id].work();
+				}
+				catch (...) {
+					lock.lock();
+					if (!failure) {
+						failure = std::current_exception();
+					}
+					changed.notify_all();
+					return;
+				}
+				lock.lock();
+
+				finished++;
+				for (TaskId successor : tasks[id].successors) {
+					if (--remaining[successor] == 0) {
+						ready.push(successor);
+					}
+				}
+				changed.notify_all();
+			}
+		};
+
+		threads = static_cast<unsigned int>(std::min<size_t>(resolveThreadCount(threads), tasks.size()));
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		for (unsigned int t = 1; t < threads; t++) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+
+		if (failure) {
+			std::rethrow_exception(failure);
+		}
+	}
+
+private:
+	struct Task {
+		std::function<void()> work;
+		std::vector<TaskId> successors;
+		size_t dependencies;
+		int priority;
+	};
+
+	std::vector<Task> tasks;
+};
@@ -91,22 +91,124 @@ void printUsage(int argc, char** argv) {
 			{ "duration", "Duration of interval over while to calculate probability." },
 			{ "number", "Number of arrivals to calculate probability" }
 		});
+	auto cacheParameterText = ColumnarText(vector<vector<string>>{
+			{ "--cache file", "Optional. Look up and store the probability in the memory mapped cache file." },
+			{ "--cache-stats yes", "Optional. Also print the cache hit and miss counts." }
+		});
+	auto quantileParameterText = ColumnarText({
+			{ "rate", "Rate of arrivals in Poisson process." },
+			{ "duration", "Duration of interval in which to count arrivals." },
+			{ "p...", "One or more probabilities." }
+		});
 	auto sampleArrivalTimesParameterText = ColumnarText({
 			{ "rate", "Rate of arrivals in Poisson process."},
 			{ "number", "Number of arrival times to sample."},
-			{ "seed", "Seed for random number generator."}
+			{ "seed", "Seed for random number generator."},
+			{ "--threads T", "Optional. Number of threads, 0 for one per core. Output does not depend on T."},
+			{ "--format F", "Optional. text (default), csv with an index column, or raw little-endian float64."},
+			{ "--output file", "Optional. Write to file instead of stdout. Raw output to a file is memory mapped."},
+			{ "--engine E", "Optional. Random engine: mt19937 (default), xoshiro or philox."}
+		});
+	auto sampleInterArrivalTimesParameterText = ColumnarText({
+			{ "rate", "Rate of arrivals in Poisson process."},
+			{ "number", "Number of inter-arrival times to sample."},
+			{ "seed", "Seed for random number generator, nonzero."},
+			{ "--first i", "Optional. Index of the first inter-arrival time, default 0."},
+			{ "--format F", "Optional. text (default), csv with an index column, or raw little-endian float64."},
+			{ "--output file", "Optional. Write to file instead of stdout. Raw output to a file is memory mapped."},
+			{ "--engine E", "Optional. Random engine: mt19937 (default), xoshiro or philox."}
 		});
 	auto sampleNumberArrivalsParameterText = ColumnarText({
 			{"rate", "Rate of arrivals in Poisson process."},
 			{"duration", "Duration of interval in which to count arrivals."},
-			{"seed", "Seed for random number generator."}
+			{"seed", "Seed for random number generator."},
+			{"--count N", "Optional. Draw N variates and print their histogram, moments and chi-square fit."},
+			{"--threads T", "Optional. Number of threads for --count, 0 for one per core."},
+			{"--engine E", "Optional. Random engine: mt19937 (default), xoshiro or philox."}
+		});
+	auto superposeParameterText = ColumnarText({
+			{ "rates-file", "File of whitespace separated arrival rates, one per source." },
+			{ "number", "Number of merged arrival times to sample." },
+			{ "seed", "Seed for random number generator." },
+			{ "--format F", "Optional. text (default), csv with an index column, or raw float64 and uint64 pairs." },
+			{ "--output file", "Optional. Write to file instead of stdout. Raw output to a file is memory mapped." },
+			{ "--engine E", "Optional. Random engine: mt19937 (default), xoshiro or philox." }
+		});
+	auto sampleProfileArrivalTimesParameterText = ColumnarText({
+			{ "profile-file", "File of whitespace separated \"time rate\" knots in increasing order of time." },
+			{ "number", "Number of arrival times to sample." },
+			{ "seed", "Seed for random number generator." },
+			{ "--interpolation I", "Optional. Rate between knots: constant (default, the earlier knot's rate) or linear." },
+			{ "--threads T", "Optional. Number of threads, 0 for one per core. Output does not depend on T." },
+			{ "--format F", "Optional. text (default), csv with an index column, or raw little-endian float64." },
+			{ "--output file", "Optional. Write to file instead of stdout. Raw output to a file is memory mapped." },
+			{ "--engine E", "Optional. Random engine: mt19937 (default), xoshiro or philox." }
+		});
+	auto simulateQueueParameterText = ColumnarText({
+			{ "arrival-rate", "Rate of arrivals in Poisson process." },
+			{ "service-rate", "Rate at which one server completes service, one over the mean service time." },
+			{ "servers", "Number of servers." },
+			{ "customers", "Number of customers to simulate." },
+			{ "seed", "Seed for random number generator." },
+			{ "--service D", "Optional. Service times: exponential (default), deterministic, uniform or lognormal." },
+			{ "--service-cv v", "Optional. Coefficient of variation of lognormal service times, default 1." },
+			{ "--report N", "Optional. Print statistics every N departures, default a tenth of customers." },
+			{ "--threads T", "Optional. Number of threads generating arrival times, 0 for one per core." },
+			{ "--engine E", "Optional. Random engine: mt19937 (default), xoshiro or philox." }
 		});
 	auto matrixTestParameterTextMatrix = vector<vector<string>>();
 	matrixTestParameterTextMatrix.push_back(vector<string>{ "test-matrix", "Filename of matrix to use for tests." });
 	auto matrixTestParameterText = ColumnarText(matrixTestParameterTextMatrix);
+	auto matrixConvertParameterText = ColumnarText({
+			{ "input", "Text matrix to convert to binary, or binary matrix to convert to text." },
+			{ "output", "Filename of converted matrix." },
+			{ "--type T", "Optional. Element type of binary output: float64 (default), float32, int32 or int64." },
+			{ "--threads T", "Optional. Number of threads parsing text, 0 (default) for one per core." }
+		});
+	auto matrixMultiplyParameterText = ColumnarText({
+			{ "a", "Text or binary matrix A." },
+			{ "b", "Text or binary matrix B." },
+			{ "--output file", "Optional. Write the product as a binary matrix and print the time taken, instead of printing it." },
+			{ "--transpose-a yes", "Optional. Multiply by the transpose of A." },
+			{ "--transpose-b yes", "Optional. Multiply by the transpose of B." },
+			{ "--type T", "Optional. Element type of text inputs: float64 (default) or float32. Binary inputs fix it." },
+			{ "--threads T", "Optional. Number of threads, 0 (default) for one per core." },
+			{ "--memory MB", "Optional. Multiply binary A and B out of core into --output, in at most about MB megabytes." }
+		});
+
+	auto matrixSparseMultiplyParameterText = ColumnarText({
+			{ "a", "Sparse matrix A in Matrix Market coordinate format (real, integer or pattern; general or symmetric)." },
+			{ "x", "Text or binary float64 matrix X, a column vector for a matrix-vector product." },
+			{ "--layout L", "Optional. Multiply with A in csr (default) or csc layout." },
+			{ "--output file", "Optional. Write A * X as a binary matrix and print the time taken, instead of printing it." },
+			{ "--threads T", "Optional. Number of threads, 0 (default) for one per core." }
+		});
+
+	auto matrixSolveParameterText = ColumnarText({
+			{ "a", "Text or binary float64 square matrix A." },
+			{ "b", "Text or binary float64 matrix B, one column per right-hand side." },
+			{ "--method M", "Optional. Factorization: lu (default), or cholesky for a symmetric positive definite A." },
+			{ "--output file", "Optional. Write X as a binary matrix and print the time taken and residual, instead of printing it." },
+			{ "--threads T", "Optional. Number of threads, 0 (default) for one per core." }
+		});
+
+	auto matrixTransposeParameterText = ColumnarText({
+			{ "input", "Binary matrix to transpose." },
+			{ "output", "Binary matrix file to write the transpose to." },
+			{ "--memory MB", "Optional. Memory budget in megabytes, default 1024." },
+			{ "--threads T", "Optional. Number of threads, 0 (default) for one per core." }
+		});
+
+	auto matrixMapParameterText = ColumnarText({
+			{ "input", "Binary float32 or float64 matrix." },
+			{ "output", "Binary matrix file to write the result to." },
+			{ "--function F", "Function applied to each element: abs, sqrt, exp, log, square, scale:x or add:x." },
+			{ "--memory MB", "Optional. Memory budget in megabytes, default 1024." },
+			{ "--threads T", "Optional. Number of threads, 0 (default) for one per core." }
+		});
 
 	cout
-		<< "Usage 1: " << programFilename << " poisson-process {pmf|cdf|sample-arrival-times} args\n\n"
+		<< "Usage 1: " << programFilename << " poisson-process {pmf|cdf|pmf-table|quantile|sample-arrival-times|sample-inter-arrival-times|sample-number-arrivals|superpose|sample-profile-arrival-times|simulate-queue} args\n\n"
 		<< "pmf|cdf\n"
 		<< "Choose whether to evaluate pmf or cdf.\n"
 		<< pdfCdfParameterText
@@ -118,21 +220,110 @@ void printUsage(int argc, char** argv) {
 		"of arrivals k equal to the argument \"number\". The sign \"=\" or \"<=\" is chosen\n"
 		"by selecting pmf or cdf respectively.\n"
 		<< endl
+		<< cacheParameterText
+		<< endl
+		<< "Cached values are keyed on rate and duration rounded to 40 significant bits. The cache\n"
+		"file is created if missing and grows as needed. It must not be shared by concurrent runs.\n"
+		<< endl
+		<< "pmf-table\n"
+		<< "Choose to evaluate the pmf and cdf for every number of arrivals from 0 to number.\n"
+		<< pdfCdfParameterText
+		<< endl
+		<< "Prints one line \"i pmf cdf\" for each number of arrivals i, computed in a single pass.\n"
+		<< endl
+		<< "quantile\n"
+		<< "Choose to evaluate the smallest number of arrivals k with P(N(t+s) - N(t) <= k) >= p.\n"
+		<< quantileParameterText
+		<< endl
+		<< "Prints one quantile per line, in the order the probabilities are given.\n"
+		<< endl
 		<< "sample-arrival-times\n"
 		<< "Choose to sample a sequence of arrival time variates.\n"
 		<< sampleArrivalTimesParameterText
 		<< endl
+		<< "Arrival times are written in chunks as they are generated, using constant memory.\n"
+		<< endl
+		<< "sample-inter-arrival-times\n"
+		<< "Choose to sample inter-arrival times first..first+number-1 of the sequence sample-arrival-times draws.\n"
+		<< sampleInterArrivalTimesParameterText
+		<< endl
+		<< "With the philox engine any slice is generated without the inter-arrival times before it.\n"
+		<< endl
 		<< "sample-number-arrivals\n"
 		<< "Choose to sample the number of arrivals in and interval.\n"
 		<< sampleNumberArrivalsParameterText
 		<< endl
+		<< "superpose\n"
+		<< "Choose to sample the merged arrivals of independent Poisson processes.\n"
+		<< superposeParameterText
+		<< endl
+		<< "Writes each arrival time with the index of its source, in time order.\n"
+		<< endl
+		<< "sample-profile-arrival-times\n"
+		<< "Choose to sample arrival times of a Poisson process whose rate follows a profile.\n"
+		<< sampleProfileArrivalTimesParameterText
+		<< endl
+		<< "The profile starts at the first knot's time and repeats after the last knot. Arrival\n"
+		"times are rate 1 arrival times mapped through the inverse of the cumulative rate.\n"
+		<< endl
+		<< "simulate-queue\n"
+		<< "Choose to simulate a first come, first served M/G/c queue fed by the Poisson process.\n"
+		<< simulateQueueParameterText
+		<< endl
+		<< "Prints running utilization, mean queue length, wait and latency with latency quantiles\n"
+		"as the simulation progresses. Events are kept in a calendar queue, so the cost per\n"
+		"customer does not grow with the number of pending events.\n"
+		<< endl
 		////////////////////////////////////////////////////////////////////////////////
-		<< "Usage 2: " << programFilename << " matrix test args\n\n"
+		<< "Usage 2: " << programFilename << " matrix {test|convert|multiply|spmv|solve|transpose|map} args\n\n"
 		<< "test\n"
 		<< "Choose whether to test matrix functions.\n"
 		<< matrixTestParameterText
 		///////////////////////////////////////////////////////////////////////////////
 		<< "\n"
-		"Calculates various matrix operations.\n"
+		"Calculates various matrix operations. The matrix may be text or binary.\n"
+		<< endl
+		<< "convert\n"
+		<< "Choose to convert a matrix between the text and binary formats.\n"
+		<< matrixConvertParameterText
+		<< endl
+		<< "A binary matrix is a 64-byte header recording the version, element type, dimensions and\n"
+		"alignment, followed by the elements in row-major order. It is memory mapped when read, so\n"
+		"it opens in constant time and its pages are shared between processes.\n"
+		<< endl
+		<< "multiply\n"
+		<< "Choose to multiply two matrices.\n"
+		<< matrixMultiplyParameterText
+		<< endl
+		<< "The product is cache blocked, uses AVX2 and FMA where compiled for them, and shares its\n"
+		"tiles between threads.\n"
+		<< endl
+		<< "spmv\n"
+		<< "Choose to multiply a sparse matrix by a dense one.\n"
+		<< matrixSparseMultiplyParameterText
+		<< endl
+		<< "Only the non-zeros of A are held in memory. CSR shares the rows and non-zeros equally\n"
+		"between threads, so a few very long rows do not leave threads idle; CSC gives each\n"
+		"thread its own copy of the result to accumulate into.\n"
+		<< endl
+		<< "solve\n"
+		<< "Choose to solve A X = B.\n"
+		<< matrixSolveParameterText
+		<< endl
+		<< "A is factorized once, by blocked LU with partial pivoting or by Cholesky, and every column\n"
+		"of B is solved with the factors. The tile updates of the factorization run as tasks on\n"
+		"all threads, each starting as soon as the tiles it reads are final.\n"
+		<< endl
+		<< "transpose\n"
+		<< "Choose to transpose a binary matrix out of core.\n"
+		<< matrixTransposeParameterText
+		<< endl
+		<< "map\n"
+		<< "Choose to apply a function to each element of a binary matrix out of core.\n"
+		<< matrixMapParameterText
+		<< endl
+		<< "Out of core, the matrices stay on disk and are streamed through the memory budget a tile\n"
+		"at a time, the next tile being read and the last written by an I/O thread while the\n"
+		"current one is computed, so matrices far larger than memory can be processed.\n"
 		<< endl;
 }
@@ -0,0 +1,210 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+static volatile double valueSink;
+
+
+void keepValue(double value) {
+	valueSink = value;
+}
+
+
+BenchmarkTimer::BenchmarkTimer() :
+	elapsed(0) {}
+
+
+void BenchmarkTimer::start() {
+	started = chrono::steady_clock::now();
+}
+
+
+void BenchmarkTimer::stop() {
+	elapsed += chrono::duration<double, nano>(chrono::steady_clock::now() - started).count();
+}
+
+
+double BenchmarkTimer::elapsedNanoseconds() const {
+	return elapsed;
+}
+
+
+static double timeIterations(const BenchmarkCase& benchmark, unsigned long long iterations) {
+	BenchmarkTimer timer;
+	benchmark.body(timer, iterations);
+	return timer.elapsedNanoseconds();
+}
+
+
+static double percentile(const vector<double>& sorted, double fraction) {
+	// Linear interpolation between the closest ranks.
+	double position = fraction * (sorted.size() - 1);
+	size_t below = static_cast<size_t>(position);
+	size_t above = min(below + 1, sorted.size() - 1);
+	return sorted[below] + (position - below) * (sorted[above] - sorted[below]);
+}
+
+
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmark, const BenchmarkSettings& settings) {
+	// Grow the iteration count until one run reaches the minimum sample time, aiming a little past it so the
+	// samples do not fall just short.
+	const double minimumNanoseconds = settings.minimumSampleMilliseconds * 1e6;
+	unsigned long long iterations = 1;
+	while (true) {
+		double elapsed = timeIterations(benchmark, iterations);
+		if (elapsed >= minimumNanoseconds) {
+			break;
+		}
+		double scale = elapsed > 0 ? 1.2 * minimumNanoseconds / elapsed : 100;
+		iterations = static_cast<unsigned long long>(iterations * min(100.0, max(2.0, scale)));
+	}
+
+	for (unsigned int i = 0; i < settings.warmupSamples; i++) {
+		timeIterations(benchmark, iterations);
+	}
+
+	vector<double> timings(max(1u, settings.samples));
+	for (double& timing : timings) {
+		timing = timeIterations(benchmark, iterations) / iterations;
+	}
+	sort(timings.begin(), timings.end());
+
+	BenchmarkResult result;
+	result.name = benchmark.name;
+	result.iterations = iterations;
+	result.samples = static_cast<unsigned int>(timings.size());
+	result.medianNanoseconds = percentile(timings, 0.5);
+	result.p10Nanoseconds = percentile(timings, 0.1);
+	result.p90Nanoseconds = percentile(timings, 0.9);
+	result.p99Nanoseconds = percentile(timings, 0.99);
+	result.minimumNanoseconds = timings.front();
+	result.maximumNanoseconds = timings.back();
+	double total = 0;
+	for (double timing : timings) {
+		total += timing;
+	}
+	result.meanNanoseconds = total / timings.size();
+	result.itemsPerSecond = benchmark.itemsPerIteration * 1e9 / result.medianNanoseconds;
+
+	return result;
+}
+
+
+void writeBenchmarkResults(ostream& os, const vector<BenchmarkResult>& results) {
+	os << "{\n  \"benchmarks\": [\n" << setprecision(6);
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+		os << "    {\"name\": \"" << result.name << "\""
+			<< ", \"iterations\": " << result.iterations
+			<< ", \"samples\": " << result.samples
+			<< ", \"median_ns\": " << result.medianNanoseconds
+			<< ", \"p10_ns\": " << result.p10Nanoseconds
+			<< ", \"p90_ns\": " << result.p90Nanoseconds
+			<< ", \"p99_ns\": " << result.p99Nanoseconds
+			<< ", \"min_ns\": " << result.minimumNanoseconds
+			<< ", \"max_ns\": " << result.maximumNanoseconds
+			<< ", \"mean_ns\": " << result.meanNanoseconds
+			<< ", \"items_per_second\": " << result.itemsPerSecond
+			<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	os << "  ]\n}" << endl;
+}
+
+
+static double readNumberField(const string& line, const string& field) {
+	size_t position = line.find("\"" + field + "\": ");
+	if (position == string::npos) {
+		return 0;
+	}
+	return strtod(line.c_str() + position + field.size() + 4, nullptr);
+}
+
+
+vector<BenchmarkResult> loadBenchmarkResults(const string& filename) {
+	// Each result is on a line of its own, so read line by line and pick the fields out by name.
+
+	ifstream resultsFile(filename);
+	if (!resultsFile) {
+		throw runtime_error("Cannot open " + filename + ".");
+	}
+
+	vector<BenchmarkResult> results;
+	string line;
+	const string namePrefix = "{\"name\": \"";
+	while (getline(resultsFile, line)) {
+		size_t nameStart = line.find(namePrefix);
+		if (nameStart == string::npos) {
+			continue;
+		}
+		nameStart += namePrefix.size();
+		size_t nameEnd = line.find('"', nameStart);
+		if (nameEnd == string::npos) {
+			throw runtime_error("Cannot parse benchmark name in " + filename + ".");
+		}
+
+		BenchmarkResult result = BenchmarkResult();
+		result.name = line.substr(nameStart, nameEnd - nameStart);
+		result.iterations = static_cast<unsigned long long>(readNumberField(line, "iterations"));
+		result.samples = static_cast<unsigned int>(readNumberField(line, "samples"));
+		result.medianNanoseconds = readNumberField(line, "median_ns");
+		result.p10Nanoseconds = readNumberField(line, "p10_ns");
+		result.p90Nanoseconds = readNumberField(line, "p90_ns");
+		result.p99Nanoseconds = readNumberField(line, "p99_ns");
+		result.minimumNanoseconds = readNumberField(line, "min_ns");
+		result.maximumNanoseconds = readNumberField(line, "max_ns");
+		result.meanNanoseconds = readNumberField(line, "mean_ns");
+		result.itemsPerSecond = readNumberField(line, "items_per_second");
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+
+bool compareBenchmarkResults(
+	ostream& os, const vector<BenchmarkResult>& baseline, const vector<BenchmarkResult>& current, double threshold) {
+	size_t nameWidth = 4;
+	for (const BenchmarkResult& result : current) {
+		nameWidth = max(nameWidth, result.name.size());
+	}
+
+	bool passed = true;
+	os << left << setw(nameWidth) << "name" << right
+		<< setw(16) << "baseline_ns" << setw(16) << "current_ns" << setw(10) << "change" << "\n";
+	for (const BenchmarkResult& result : current) {
+		auto previous = find_if(baseline.begin(), baseline.end(), [&](const BenchmarkResult& candidate) {
+			return candidate.name == result.name;
+		});
+		if (previous == baseline.end() || !(previous->medianNanoseconds > 0)) {
+			os << left << setw(nameWidth) << result.name << right
+				<< setw(16) << "-" << setw(16) << result.medianNanoseconds << setw(10) << "-" << "  new\n";
+			continue;
+		}
+
+		double change = result.medianNanoseconds / previous->medianNanoseconds - 1;
+		const char* verdict = "";
+		if (change > threshold) {
+			verdict = "  REGRESSION";
+			passed = false;
+		}
+		else if (change < -threshold) {
+			verdict = "  improved";
+		}
+
+		ostringstream changeText;
+		changeText << showpos << fixed << setprecision(1) << 100 * change << "%";
+		os << left << setw(nameWidth) << result.name << right << setprecision(6)
+			<< setw(16) << previous->medianNanoseconds << setw(16) << result.medianNanoseconds
+			<< setw(10) << changeText.str() << verdict << "\n";
+	}
+	os.flush();
+
+	return passed;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Accumulates the time between start() and stop() calls, so a benchmark body can leave its setup untimed.
+class BenchmarkTimer {
+public:
+	BenchmarkTimer();
+
+	void start();
+	void stop();
+	double elapsedNanoseconds() const;
+
+private:
+	std::chrono::steady_clock::time_point started;
+	double elapsed;
+};
+
+// A named case whose body runs the measured operation iterations times, bracketing it with the timer.
+// itemsPerIteration is the number of items (variates, elements, steps) one iteration processes, or 0 if the case
+// has no meaningful throughput.
+struct BenchmarkCase {
+	std::string name;
+	double itemsPerIteration;
+	std::function<void(BenchmarkTimer& timer, unsigned long long iterations)> body;
+};
+
+// Each case is first calibrated to the number of iterations whose run takes at least minimumSampleMilliseconds,
+// then run warmupSamples times with the timings discarded, then samples times.
+struct BenchmarkSettings {
+	unsigned int warmupSamples;
+	unsigned int samples;
+	double minimumSampleMilliseconds;
+};
+
+// Timings are nanoseconds per iteration over the samples.
+struct BenchmarkResult {
+	std::string name;
+	unsigned long long iterations;
+	unsigned int samples;
+	double medianNanoseconds;
+	double p10Nanoseconds;
+	double p90Nanoseconds;
+	double p99Nanoseconds;
+	double minimumNanoseconds;
+	double maximumNanoseconds;
+	double meanNanoseconds;
+	double itemsPerSecond;
+};
+
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmark, const BenchmarkSettings& settings);
+
+// Write results as a JSON document with one object per line in its "benchmarks" array.
+void writeBenchmarkResults(std::ostream& os, const std::vector<BenchmarkResult>& results);
+
+// Read the names and timings of results written by writeBenchmarkResults. Throws std::runtime_error if the file
+// cannot be read.
+std::vector<BenchmarkResult> loadBenchmarkResults(const std::string& filename);
+
+// Print the change in median time of every case found in both baseline and current, marking a case REGRESSION if
+// its median grew by more than threshold, a fraction. Returns whether no case regressed.
+bool compareBenchmarkResults(
+	std::ostream& os, const std::vector<BenchmarkResult>& baseline, const std::vector<BenchmarkResult>& current,
+	double threshold);
+
+// Store a value where the compiler cannot see it is unused, so the computation producing it is not removed.
+void keepValue(double value);
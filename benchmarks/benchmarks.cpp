@@ -0,0 +1,416 @@
+// benchmarks.cpp : Times the Poisson, Matrix and GridWorld hot paths and reports them as JSON.
+//
+
+#include "Benchmark.hpp"
+#include "PoissonProcess.hpp"
+#include "Matrix.hpp"
+#include "MatrixMultiply.hpp"
+#include "SparseMatrix.hpp"
+#include "MatrixFactorization.hpp"
+#include "OutOfCoreMatrix.hpp"
+#include "Agent.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+static vector<string> temporaryFiles;
+
+
+static string matrixFile(unsigned long size) {
+	// Return the name of a file holding a size x size matrix, writing it on first use.
+
+	string filename = "benchmark_matrix_" + to_string(size) + ".txt";
+	if (find(temporaryFiles.begin(), temporaryFiles.end(), filename) != temporaryFiles.end()) {
+		return filename;
+	}
+
+	ofstream file(filename);
+	file << size << " " << size << "\n";
+	for (unsigned long row = 0; row < size; row++) {
+		for (unsigned long col = 0; col < size; col++) {
+			file << (row * size + col) % 1000 * 0.125 << (col + 1 == size ? "\n" : " ");
+		}
+	}
+	temporaryFiles.push_back(filename);
+
+	return filename;
+}
+
+
+static string temporaryFile(const string& filename) {
+	// Return filename, registered to be removed at exit.
+
+	if (find(temporaryFiles.begin(), temporaryFiles.end(), filename) == temporaryFiles.end()) {
+		temporaryFiles.push_back(filename);
+	}
+	return filename;
+}
+
+
+static string binaryMatrixFile(unsigned long size) {
+	// Return the name of a binary file holding a size x size float64 matrix, writing it on first use.
+
+	string filename = "benchmark_matrix_" + to_string(size) + ".bin";
+	if (find(temporaryFiles.begin(), temporaryFiles.end(), filename) != temporaryFiles.end()) {
+		return filename;
+	}
+
+	Matrix<double> matrix(size, size);
+	for (unsigned long row = 0; row < size; row++) {
+		for (unsigned long col = 0; col < size; col++) {
+			matrix(row, col) = (row * size + col) % 1000 * 0.125;
+		}
+	}
+	saveMatrixBinary(matrix.view(), filename);
+	temporaryFiles.push_back(filename);
+
+	return filename;
+}
+
+
+// Sparse matrix shaped like a power-law graph: 200000 rows of eight non-zeros, except every thousandth row, which has
+// 20000. Built on first use and shared by the SpMV cases.
+static const unsigned long powerLawRows = 200000;
+static const size_t powerLawNonZeros = (powerLawRows / 1000) * 20000 + (powerLawRows - powerLawRows / 1000) * 8;
+
+static const CsrMatrix<double>& powerLawMatrix() {
+	static const CsrMatrix<double> matrix = []() {
+		vector<size_t> offsets(1, 0);
+		vector<uint32_t> indices;
+		for (unsigned long row = 0; row < powerLawRows; row++) {
+			size_t count = row % 1000 == 0 ? 20000 : 8;
+			size_t first = indices.size();
+			for (size_t i = 0; i < count; i++) {
+				indices.push_back(static_cast<uint32_t>((row + i * (powerLawRows / count)) % powerLawRows));
+			}
+			sort(indices.begin() + first, indices.end());
+			offsets.push_back(indices.size());
+		}
+		vector<double> values(indices.size(), 0.5);
+		return CsrMatrix<double>(powerLawRows, powerLawRows, move(offsets), move(indices), move(values));
+	}();
+	return matrix;
+}
+
+static vector<BenchmarkCase> benchmarkCases() {
+	vector<BenchmarkCase> cases;
+
+	// PMF and CDF at the mode of distributions with growing mean, where k = L*s.
+	for (unsigned long k : { 10ul, 1000ul, 100000ul, 10000000ul }) {
+		cases.push_back({ "pmf/k=" + to_string(k), 1, [k](BenchmarkTimer& timer, unsigned long long iterations) {
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				keepValue(evalPoissonProcessIntervalPMF(1, static_cast<double>(k), k));
+			}
+			timer.stop();
+		} });
+		cases.push_back({ "cdf/k=" + to_string(k), 1, [k](BenchmarkTimer& timer, unsigned long long iterations) {
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				keepValue(evalPoissonProcessIntervalCDF(1, static_cast<double>(k), k));
+			}
+			timer.stop();
+		} });
+	}
+
+	// Sampling throughput, in variates per second, for growing batches.
+	for (size_t n : { size_t(1000), size_t(100000), size_t(10000000) }) {
+		cases.push_back({ "sample-arrival-times/n=" + to_string(n), static_cast<double>(n),
+			[n](BenchmarkTimer& timer, unsigned long long iterations) {
+			PoissonSampler sampler(1);
+			vector<double> arrivalTimes(n);
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				keepValue(sampler.fillArrivalTimes(2, arrivalTimes.data(), n));
+			}
+			timer.stop();
+		} });
+		cases.push_back({ "sample-number-arrivals/n=" + to_string(n), static_cast<double>(n),
+			[n](BenchmarkTimer& timer, unsigned long long iterations) {
+			PoissonSampler sampler(1);
+			PoissonVariateGenerator variates(100);
+			vector<unsigned long> counts(n);
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				sampler.fillPoisson(variates, counts.data(), n);
+				keepValue(static_cast<double>(counts[n - 1]));
+			}
+			timer.stop();
+		} });
+	}
+
+	// Matrix load from a text file and print to a string, in elements per second.
+	for (unsigned long size : { 10ul, 100ul, 1000ul }) {
+		cases.push_back({ "matrix-load/n=" + to_string(size), static_cast<double>(size * size),
+			[size](BenchmarkTimer& timer, unsigned long long iterations) {
+			string filename = matrixFile(size);
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				Matrix<double> matrix = Matrix<double>::load(filename);
+				keepValue(matrix(0, 0));
+			}
+			timer.stop();
+		} });
+		cases.push_back({ "matrix-print/n=" + to_string(size), static_cast<double>(size * size),
+			[size](BenchmarkTimer& timer, unsigned long long iterations) {
+			Matrix<double> matrix = Matrix<double>::load(matrixFile(size));
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				ostringstream os;
+				os << matrix;
+				keepValue(static_cast<double>(os.tellp()));
+			}
+			timer.stop();
+		} });
+	}
+
+	// Matrix multiply on all cores, in floating point operations per second.
+	for (unsigned long size : { 64ul, 256ul, 1024ul }) {
+		cases.push_back({ "matrix-multiply/n=" + to_string(size), 2.0 * size * size * size,
+			[size](BenchmarkTimer& timer, unsigned long long iterations) {
+			Matrix<double> a(size, size, vector<double>(size * size, 1.0 / size));
+			Matrix<double> b(size, size, vector<double>(size * size, 2.0));
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				Matrix<double> product = multiply(a.view(), b.view());
+				keepValue(product(0, 0));
+			}
+			timer.stop();
+		} });
+	}
+
+	// Chained element-wise arithmetic and a fused reduction over a 1000 x 1000 matrix, in elements per second.
+	cases.push_back({ "matrix-expression/n=1000", 1e6,
+		[](BenchmarkTimer& timer, unsigned long long iterations) {
+		Matrix<double> a(1000, 1000, vector<double>(1000 * 1000, 0.25));
+		Matrix<double> b(1000, 1000, vector<double>(1000 * 1000, 0.75));
+		Matrix<double> scaled(1000, 1000);
+		timer.start();
+		for (unsigned long long i = 0; i < iterations; i++) {
+			scaled = ((a - 0.5) * 2.0 + b) / 3.0 - a * 0.25 + 1.0;
+			keepValue(dot(scaled, b));
+		}
+		timer.stop();
+	} });
+
+	// Fixed-size 4x4 products and 3x3 inverses, in matrices per second.
+	cases.push_back({ "matrix-fixed/multiply-4x4", 1024,
+		[](BenchmarkTimer& timer, unsigned long long iterations) {
+		vector<Matrix<float, 4, 4>> transforms(1024, Matrix<float, 4, 4>::identity() * 0.5f);
+		timer.start();
+		for (unsigned long long i = 0; i < iterations; i++) {
+			Matrix<float, 4, 4> product = Matrix<float, 4, 4>::identity();
+			for (const auto& transform : transforms) {
+				product = multiply(product, transform) * 2.0f;
+			}
+			keepValue(product(0, 0));
+		}
+		timer.stop();
+	} });
+	cases.push_back({ "matrix-fixed/inverse-3x3", 1024,
+		[](BenchmarkTimer& timer, unsigned long long iterations) {
+		vector<Matrix<double, 3, 3>> matrices;
+		for (int i = 0; i < 1024; i++) {
+			matrices.push_back(Matrix<double, 3, 3>({ 2.0 + i, 0, 1, 1, 3, 2, 1, 1, 2 }));
+		}
+		timer.start();
+		for (unsigned long long i = 0; i < iterations; i++) {
+			double total = 0;
+			for (const auto& matrix : matrices) {
+				total += inverse(matrix)(1, 1);
+			}
+			keepValue(total);
+		}
+		timer.stop();
+	} });
+
+	// LU and Cholesky factorization on all cores, in floating point operations per second.
+	for (unsigned long size : { 256ul, 1024ul }) {
+		cases.push_back({ "matrix-factorize/lu/n=" + to_string(size), 2.0 / 3.0 * size * size * size,
+			[size](BenchmarkTimer& timer, unsigned long long iterations) {
+			Matrix<double> a(size, size);
+			for (unsigned long i = 0; i < size; i++) {
+				for (unsigned long j = 0; j < size; j++) {
+					a(i, j) = i == j ? size : 1.0 / (1 + i + 2 * j);
+				}
+			}
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				LuFactorization<double> lu(a.view());
+				keepValue(lu.factors()(size - 1, size - 1));
+			}
+			timer.stop();
+		} });
+		cases.push_back({ "matrix-factorize/cholesky/n=" + to_string(size), 1.0 / 3.0 * size * size * size,
+			[size](BenchmarkTimer& timer, unsigned long long iterations) {
+			Matrix<double> a(size, size);
+			for (unsigned long i = 0; i < size; i++) {
+				for (unsigned long j = 0; j < size; j++) {
+					a(i, j) = i == j ? size : 1.0 / (1 + i + j);
+				}
+			}
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				CholeskyFactorization<double> cholesky(a.view());
+				keepValue(cholesky.factor()(size - 1, size - 1));
+			}
+			timer.stop();
+		} });
+	}
+
+	// Out-of-core transpose and multiply of binary files through an 8 MB budget, in elements and floating point
+	// operations per second. The files are small enough to stay in the page cache, so this measures the tiling and
+	// the overlap of I/O with computation rather than the disk.
+	const size_t outOfCoreBudget = 8 << 20;
+	cases.push_back({ "matrix-out-of-core/transpose/n=2048", 2048.0 * 2048,
+		[outOfCoreBudget](BenchmarkTimer& timer, unsigned long long iterations) {
+		string input = binaryMatrixFile(2048);
+		string output = temporaryFile("benchmark_transpose.bin");
+		timer.start();
+		for (unsigned long long i = 0; i < iterations; i++) {
+			transposeMatrixFile<double>(input, output, outOfCoreBudget);
+		}
+		timer.stop();
+	} });
+	cases.push_back({ "matrix-out-of-core/multiply/n=1024", 2.0 * 1024 * 1024 * 1024,
+		[outOfCoreBudget](BenchmarkTimer& timer, unsigned long long iterations) {
+		string input = binaryMatrixFile(1024);
+		string output = temporaryFile("benchmark_product.bin");
+		timer.start();
+		for (unsigned long long i = 0; i < iterations; i++) {
+			multiplyMatrixFiles<double>(input, input, output, Transpose::no, Transpose::no, outOfCoreBudget);
+		}
+		timer.stop();
+	} });
+
+	// Sparse matrix-vector products on all cores, in non-zeros per second.
+	for (bool csc : { false, true }) {
+		cases.push_back({ csc ? "matrix-spmv/csc" : "matrix-spmv/csr", static_cast<double>(powerLawNonZeros),
+			[csc](BenchmarkTimer& timer, unsigned long long iterations) {
+			const CsrMatrix<double>& csr = powerLawMatrix();
+			CscMatrix<double> transposed = csc ? toCsc(csr) : CscMatrix<double>();
+			Matrix<double> x(csr.nCols(), 1, vector<double>(csr.nCols(), 1.0));
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				Matrix<double> y = csc ? multiply(transposed, x.view()) : multiply(csr, x.view());
+				keepValue(y(0, 0));
+			}
+			timer.stop();
+		} });
+	}
+
+	// GridWorld steps per second, one world per space invader agent, every world stepped once per iteration.
+	for (size_t agentCount : { size_t(1), size_t(16), size_t(256), size_t(4096) }) {
+		cases.push_back({ "gridworld/agents=" + to_string(agentCount), static_cast<double>(agentCount),
+			[agentCount](BenchmarkTimer& timer, unsigned long long iterations) {
+			vector<GW_SR_Agent> agents;
+			agents.reserve(agentCount);
+			for (size_t i = 0; i < agentCount; i++) {
+				agents.push_back(GW_SR_Agent(new GridWorld::LocalView, new GridWorld::SpaceInvader(i % 2 == 0, 0, 9)));
+			}
+			vector<GridWorld> worlds;
+			worlds.reserve(agentCount);
+			for (GW_SR_Agent& agent : agents) {
+				worlds.emplace_back(agent, GridWorld::Coordinate(0, 9), GridWorld::Coordinate(9, 9));
+			}
+
+			timer.start();
+			for (unsigned long long i = 0; i < iterations; i++) {
+				for (GridWorld& world : worlds) {
+					world.run();
+				}
+			}
+			timer.stop();
+		} });
+	}
+
+	return cases;
+}
+
+
+static void printUsage(const char* programName) {
+	cout << "Usage: " << programName << " [options]\n\n"
+		<< "  --filter text      Run only cases whose name contains text.\n"
+		<< "  --warmup N         Untimed samples before measuring, default 2.\n"
+		<< "  --samples N        Timed samples per case, default 15.\n"
+		<< "  --min-time ms      Minimum duration of one sample, default 20.\n"
+		<< "  --output file      Write the JSON results to file instead of stdout.\n"
+		<< "  --compare file     Compare median times with the JSON results in file and exit with status 1\n"
+		<< "                     if any case is slower by more than the threshold. Without --output the\n"
+		<< "                     JSON results are not printed.\n"
+		<< "  --threshold f      Fraction by which a median may grow before it is a regression, default 0.1.\n"
+		<< endl;
+}
+
+
+int main(int argc, char** argv) {
+	const vector<string> allowedOptions = { "filter", "warmup", "samples", "min-time", "output", "compare", "threshold" };
+	unordered_map<string, string> options;
+	for (int i = 1; i < argc; i += 2) {
+		string arg(argv[i]);
+		if (arg.compare(0, 2, "--") != 0 ||
+			find(allowedOptions.begin(), allowedOptions.end(), arg.substr(2)) == allowedOptions.end() ||
+			i + 1 >= argc) {
+			cout << "ERROR: Unknown option or missing value " << arg << "." << endl;
+			printUsage(argv[0]);
+			return 2;
+		}
+		options[arg.substr(2)] = argv[i + 1];
+	}
+
+	BenchmarkSettings settings = { 2, 15, 20 };
+	double threshold = 0.1;
+	stringstream(options["warmup"]) >> settings.warmupSamples;
+	stringstream(options["samples"]) >> settings.samples;
+	stringstream(options["min-time"]) >> settings.minimumSampleMilliseconds;
+	stringstream(options["threshold"]) >> threshold;
+
+	vector<BenchmarkResult> baseline;
+	try {
+		if (options.count("compare")) {
+			baseline = loadBenchmarkResults(options["compare"]);
+		}
+	}
+	catch (const exception& error) {
+		cout << "ERROR: " << error.what() << endl;
+		return 2;
+	}
+
+	vector<BenchmarkResult> results;
+	for (const BenchmarkCase& benchmark : benchmarkCases()) {
+		if (benchmark.name.find(options["filter"]) == string::npos) {
+			continue;
+		}
+		results.push_back(runBenchmark(benchmark, settings));
+	}
+	for (const string& filename : temporaryFiles) {
+		remove(filename.c_str());
+	}
+
+	if (options.count("output")) {
+		ofstream outputFile(options["output"]);
+		if (!outputFile) {
+			cout << "ERROR: Cannot open " << options["output"] << "." << endl;
+			return 2;
+		}
+		writeBenchmarkResults(outputFile, results);
+	}
+	else if (!options.count("compare")) {
+		writeBenchmarkResults(cout, results);
+	}
+
+	if (options.count("compare") && !compareBenchmarkResults(cout, baseline, results, threshold)) {
+		return 1;
+	}
+
+	return 0;
+}